@@ -0,0 +1,155 @@
+#include <iostream>
+#include <fstream>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "archive.h"
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+              "archives are read in place, as little-endian data");
+
+static const char magic[4] = { 'B', 'R', 'P', 'A' };
+static const uint32_t version = 1;
+static const size_t headerSize = 16;
+
+static void invalidArchive(string fName, string reason) {
+    cerr << "invalid archive " << fName << ": " << reason << endl;
+    exit(10);
+}
+
+InstanceArchive::InstanceArchive(string fName)
+    : fName_(fName), data_(NULL), fileSize_(0), count_(0) {
+    int fd = open(fName.c_str(), O_RDONLY);
+    struct stat info;
+    if ( fd < 0 || fstat(fd, &info) != 0 ) {
+        cerr << "cannot read archive: " << fName << endl;
+        exit(10);
+    }
+    fileSize_ = info.st_size;
+    if ( fileSize_ < headerSize ) {
+        invalidArchive(fName, "no header");
+    }
+    void *mapped = mmap(NULL, fileSize_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if ( mapped == MAP_FAILED ) {
+        cerr << "cannot map archive: " << fName << endl;
+        exit(10);
+    }
+    data_ = (const char *) mapped;
+    const uint32_t *header = (const uint32_t *) data_;
+    if ( memcmp(data_, magic, sizeof(magic)) != 0 || header[1] != version ) {
+        invalidArchive(fName, "bad magic number or version");
+    }
+    count_ = header[2];
+    if ( headerSize + 8 * count_ > fileSize_ ) {
+        invalidArchive(fName, "truncated index");
+    }
+    // records are checked by record() when they are accessed, so that
+    // opening does not read the whole file
+}
+
+InstanceArchive::~InstanceArchive() {
+    if ( data_ != NULL ) {
+        munmap((void *) data_, fileSize_);
+    }
+}
+
+bool InstanceArchive::isArchive(string fName) {
+    ifstream ifs(fName, ifstream::binary);
+    char start[sizeof(magic)];
+    return ifs.read(start, sizeof(start)) &&
+        memcmp(start, magic, sizeof(magic)) == 0;
+}
+
+const uint16_t *InstanceArchive::record(size_t i) const {
+    const uint64_t *offsets = (const uint64_t *) (data_ + headerSize);
+    uint64_t offset = offsets[i];
+    if ( offset % 2 != 0 || offset > fileSize_ - 6 ) {
+        invalidArchive(fName_, "truncated record " + to_string(i));
+    }
+    const uint16_t *r = (const uint16_t *) (data_ + offset);
+    if ( offset + 2 * (3 + r[0] + r[1]) + r[2] > fileSize_ ) {
+        invalidArchive(fName_, "truncated record " + to_string(i));
+    }
+    return r;
+}
+
+string InstanceArchive::name(size_t i) const {
+    const uint16_t *r = record(i);
+    return string((const char *) (r + 3 + r[0] + r[1]), r[2]);
+}
+
+BRPState InstanceArchive::state(size_t i, string maxHeightType) const {
+    const uint16_t *r = record(i);
+    int W = r[0];
+    int n = r[1];
+    const uint16_t *heights = r + 3;
+    const uint16_t *items = heights + W;
+    int total = 0;
+    for (int s=0; s < W; s++) {
+        total += heights[s];
+    }
+    vector<bool> seen(n + 1, false);
+    bool valid = W > 0 && total == n;
+    for (int j=0; valid && j < n; j++) {
+        valid = items[j] >= 1 && items[j] <= n && ! seen[items[j]];
+        if ( valid ) {
+            seen[items[j]] = true;
+        }
+    }
+    if ( ! valid ) {
+        invalidArchive(fName_, "bad instance " + name(i));
+    }
+    return BRPState(W, heights, items, maxHeightType);
+}
+
+static void append16(string &buffer, uint16_t value) {
+    buffer.append((const char *) &value, sizeof(value));
+}
+
+void writeArchive(const vector<string> &instances, string fName) {
+    string index;
+    string records;
+    size_t start = headerSize + 8 * instances.size();
+    for (auto instance: instances) {
+        // reading through BRPState checks the instance
+        const BRPState s(instance, "unlimited");
+        if ( s.W() > UINT16_MAX || s.n() > UINT16_MAX ||
+             instance.size() > UINT16_MAX ) {
+            cerr << "instance too large for an archive: " << instance
+                 << endl;
+            exit(10);
+        }
+        uint64_t offset = start + records.size();
+        index.append((const char *) &offset, sizeof(offset));
+        append16(records, s.W());
+        append16(records, s.n());
+        append16(records, instance.size());
+        for (auto &stack: s.stacks()) {
+            append16(records, stack.size());
+        }
+        for (auto &stack: s.stacks()) {
+            for (auto item: stack) {
+                append16(records, item);
+            }
+        }
+        records += instance;
+        if ( records.size() % 2 != 0 ) {
+            records += '\0';
+        }
+    }
+    uint32_t header[4] = { 0, version, (uint32_t) instances.size(), 0 };
+    memcpy(header, magic, sizeof(magic));
+    ofstream ofs(fName, ofstream::binary);
+    ofs.write((const char *) header, sizeof(header));
+    ofs.write(index.data(), index.size());
+    ofs.write(records.data(), records.size());
+    if ( ! ofs ) {
+        cerr << "cannot write archive: " << fName << endl;
+        exit(10);
+    }
+}
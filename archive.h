@@ -0,0 +1,55 @@
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+// binary archive of many instances, memory-mapped when read
+// all fields are little-endian:
+//   header   "BRPA", uint32 version, uint32 count, uint32 reserved
+//   index    count uint64 record offsets, from the start of the file
+//   records  uint16 W, uint16 n, uint16 name length, W uint16 heights,
+//            n uint16 items (stacks one after the other, from bottom to
+//            top), the name, padding to an even offset
+// so bays of up to 65535 items and stacks fit
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "brpstate.h"
+
+using namespace std;
+
+class InstanceArchive {
+public:
+    // exits if fName is not a valid archive
+    explicit InstanceArchive(string fName);
+    ~InstanceArchive();
+
+    InstanceArchive(const InstanceArchive &) = delete;
+    InstanceArchive &operator=(const InstanceArchive &) = delete;
+
+    // true if fName starts like an archive
+    static bool isArchive(string fName);
+
+    size_t size() const { return count_; }
+
+    // the file the instance was converted from
+    string name(size_t i) const;
+
+    // the instance is read straight from the mapped file; exits if its
+    // items are not 1..n, each once
+    BRPState state(size_t i, string maxHeightType) const;
+
+protected:
+    // exits if record i does not fit in the file
+    const uint16_t *record(size_t i) const;
+
+    string fName_;
+    const char *data_;
+    size_t fileSize_;
+    size_t count_;
+};
+
+// convert instances by Caserta et al. to an archive
+void writeArchive(const vector<string> &instances, string fName);
+
+#endif
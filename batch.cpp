@@ -0,0 +1,142 @@
+#include <fstream>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <functional>
+
+#include <glob.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "batch.h"
+#include "genpolicy.h"
+#include "counters.h"
+
+vector<string> listInstances(string source) {
+    vector<string> result;
+    struct stat info;
+    if ( source.find_first_of("*?[") != string::npos ) {
+        glob_t matches;
+        if ( glob(source.c_str(), 0, NULL, &matches) == 0 ) {
+            for (size_t i=0; i < matches.gl_pathc; i++) {
+                result.push_back(matches.gl_pathv[i]);
+            }
+        }
+        globfree(&matches);
+    } else if ( stat(source.c_str(), &info) != 0 ) {
+        cerr << "cannot access instance: " << source << endl;
+        exit(7);
+    } else if ( S_ISDIR(info.st_mode) ) {
+        DIR *dir = opendir(source.c_str());
+        struct dirent *entry;
+        while ( dir != NULL && (entry = readdir(dir)) != NULL ) {
+            string name = entry->d_name;
+            if ( name.size() > 4 &&
+                 name.substr(name.size() - 4) == ".dat" ) {
+                result.push_back(source + "/" + name);
+            }
+        }
+        if ( dir != NULL ) {
+            closedir(dir);
+        }
+        sort(result.begin(), result.end());
+    } else {
+        // an instance starts with a number, a list with a file name
+        ifstream ifs(source);
+        string first;
+        ifs >> first;
+        if ( first.empty() || isdigit(first[0]) ) {
+            result.push_back(source);
+        } else {
+            ifs.seekg(0);
+            string line;
+            while ( getline(ifs, line) ) {
+                if ( ! line.empty() && line[0] != '#' ) {
+                    result.push_back(line);
+                }
+            }
+        }
+    }
+    if ( result.empty() ) {
+        cerr << "no instance found in " << source << endl;
+        exit(7);
+    }
+    return result;
+}
+
+// nInstances instances, the i-th one called name(i) and read by load(i),
+// which are called by several workers at once
+static void solveAll(size_t nInstances,
+                     function<string(size_t)> name,
+                     function<BRPState(size_t)> load,
+                     const BatchSettings &settings,
+                     ostream &os) {
+    mutex outputMutex;
+    atomic<unsigned int> nextInstance(0);
+    auto worker = [&]() {
+        // the solver is kept from one instance to the next
+        auto solver = genPolicy(settings.method, settings.context,
+                                settings.timeLimit, settings.bbStrategy,
+                                false);
+        unsigned int i;
+        while ( (i = nextInstance++) < nInstances ) {
+            BRPState s = load(i);
+            s.setLBVersion(settings.lbVersion);
+            Deadline deadline(settings.timeLimit);
+            auto before = chrono::steady_clock::now();
+            auto result = solver->solve(s, deadline);
+            double time = chrono::duration<double>(
+                chrono::steady_clock::now() - before).count();
+            string status = "feasible";
+            if ( result->nRelocations() == s.LB3() ||
+                 ( solver->exact() && ! deadline.reached() ) ) {
+                status = "optimal";
+            } else if ( deadline.reached() ) {
+                status = "timeout";
+            }
+            if ( settings.solutions != NULL ) {
+                settings.solutions->write(name(i), s, *result);
+            }
+            lock_guard<mutex> lock(outputMutex);
+            os << "{\"instance\": \"" << name(i) << "\", "
+               << "\"method\": \"" << settings.method << "\", "
+               << "\"relocations\": " << result->nRelocations() << ", "
+               << "\"time\": " << time << ", "
+               << "\"status\": \"" << status << "\"}" << endl;
+        }
+        Counters::mergeThread();
+    };
+    vector<thread> threads;
+    unsigned int nThreads = min<size_t>(max(1u, settings.nThreads),
+                                        nInstances);
+    for (unsigned int t=0; t < nThreads; t++) {
+        threads.push_back(thread(worker));
+    }
+    for (auto &t: threads) {
+        t.join();
+    }
+}
+
+void solveBatch(const vector<string> &instances,
+                const BatchSettings &settings,
+                ostream &os) {
+    solveAll(instances.size(),
+             [&](size_t i) { return instances[i]; },
+             [&](size_t i) {
+                 return BRPState(instances[i], settings.maxHeightType);
+             },
+             settings, os);
+}
+
+void solveBatch(const InstanceArchive &archive,
+                const BatchSettings &settings,
+                ostream &os) {
+    solveAll(archive.size(),
+             [&](size_t i) { return archive.name(i); },
+             [&](size_t i) {
+                 return archive.state(i, settings.maxHeightType);
+             },
+             settings, os);
+}
@@ -0,0 +1,46 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <vector>
+#include <string>
+#include <iostream>
+
+#include "solvercontext.h"
+#include "archive.h"
+#include "solutionsink.h"
+
+using namespace std;
+
+// instances given as a directory (all its .dat files), a glob pattern, a
+// file listing one instance per line, or a single instance file
+vector<string> listInstances(string source);
+
+struct BatchSettings {
+    // UB procedures and settings; should be quiet, as progress reports of
+    // the solvers would be mixed up with the results
+    shared_ptr<const SolverContext> context;
+    int lbVersion = 1;
+    string method = "LA-1";
+    string maxHeightType = "unlimited";
+    string bbStrategy = "depth";
+    // per instance, 0 means no limit
+    int timeLimit = 0;
+    // number of workers, each one solves one instance at a time
+    unsigned int nThreads = 1;
+    // where solutions are written, if not NULL
+    SolutionSink *solutions = NULL;
+};
+
+// solve all instances and write one json line per instance to os:
+// instance name, method, relocations, time and status, which is optimal,
+// timeout or feasible
+void solveBatch(const vector<string> &instances,
+                const BatchSettings &settings,
+                ostream &os);
+
+// same, for the instances of an archive
+void solveBatch(const InstanceArchive &archive,
+                const BatchSettings &settings,
+                ostream &os);
+
+#endif
@@ -0,0 +1,332 @@
+// benchmark driver: solves every instance with every method, several times,
+// and reports wall time, relocations, nodes/s and peak RSS
+// results can be compared against a baseline written by an earlier run
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <chrono>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "brpstate.h"
+#include "genpolicy.h"
+#include "counters.h"
+#include "batch.h"
+
+using namespace std;
+
+// one line of the results: an (instance, method) pair over all repetitions
+struct BenchResult {
+    string instance;
+    string method;
+    int reps;
+    unsigned int relocations;
+    double timeMin;
+    double timeMedian;
+    long long nodes;
+    double nodesPerSecond;
+    long peakRSS;
+};
+
+// comma-separated list
+vector<string> splitList(string list) {
+    vector<string> result;
+    stringstream ss(list);
+    string item;
+    while ( getline(ss, item, ',') ) {
+        if ( item != "" ) {
+            result.push_back(item);
+        }
+    }
+    return result;
+}
+
+string csvHeader() {
+    return "instance,method,reps,relocations,time_min,time_median,nodes,"
+        "nodes_per_s,peak_rss_kb";
+}
+
+void writeCSV(ostream &os, const BenchResult &r) {
+    os << r.instance << "," << r.method << "," << r.reps << ","
+       << r.relocations << "," << r.timeMin << "," << r.timeMedian << ","
+       << r.nodes << "," << r.nodesPerSecond << "," << r.peakRSS << endl;
+}
+
+void writeJSON(ostream &os, const BenchResult &r, bool first) {
+    os << (first ? "" : ",\n")
+       << "  {\"instance\": \"" << r.instance << "\", "
+       << "\"method\": \"" << r.method << "\", "
+       << "\"reps\": " << r.reps << ", "
+       << "\"relocations\": " << r.relocations << ", "
+       << "\"time_min\": " << r.timeMin << ", "
+       << "\"time_median\": " << r.timeMedian << ", "
+       << "\"nodes\": " << r.nodes << ", "
+       << "\"nodes_per_s\": " << r.nodesPerSecond << ", "
+       << "\"peak_rss_kb\": " << r.peakRSS << "}";
+}
+
+BenchResult readCSV(string line) {
+    stringstream ss(line);
+    BenchResult r;
+    string field;
+    getline(ss, r.instance, ',');
+    getline(ss, r.method, ',');
+    getline(ss, field, ','); r.reps = stoi(field);
+    getline(ss, field, ','); r.relocations = stoul(field);
+    getline(ss, field, ','); r.timeMin = stod(field);
+    getline(ss, field, ','); r.timeMedian = stod(field);
+    getline(ss, field, ','); r.nodes = stoll(field);
+    getline(ss, field, ','); r.nodesPerSecond = stod(field);
+    getline(ss, field, ','); r.peakRSS = stol(field);
+    return r;
+}
+
+// baseline is a csv file written by a previous run
+map<pair<string, string>, BenchResult> readBaseline(string fName) {
+    map<pair<string, string>, BenchResult> baseline;
+    ifstream in(fName);
+    if ( ! in ) {
+        cerr << "cannot read baseline: " << fName << endl;
+        exit(7);
+    }
+    string line;
+    getline(in, line);
+    if ( line != csvHeader() ) {
+        cerr << "baseline is not a csv file written by brp-bench: "
+             << fName << endl;
+        exit(7);
+    }
+    while ( getline(in, line) ) {
+        BenchResult r = readCSV(line);
+        baseline[make_pair(r.instance, r.method)] = r;
+    }
+    return baseline;
+}
+
+BenchResult run(string instance, string method, string maxHeightType,
+                shared_ptr<const SolverContext> context, int LB,
+                int timeLimit, int warmup, int reps) {
+    BRPState s(instance, maxHeightType);
+    s.setLBVersion(LB);
+    auto solver = genPolicy(method, context, timeLimit);
+    for (int i=0; i < warmup; i++) {
+        solver->solve(s, Deadline(timeLimit));
+    }
+    BenchResult r;
+    r.instance = instance;
+    r.method = method;
+    r.reps = reps;
+    r.relocations = 0;
+    r.nodes = 0;
+    vector<double> times;
+    for (int i=0; i < reps; i++) {
+        Counters::reset();
+        auto before = chrono::steady_clock::now();
+        auto result = solver->solve(s, Deadline(timeLimit));
+        auto after = chrono::steady_clock::now();
+        times.push_back(chrono::duration<double>(after - before).count());
+        // all repetitions should agree, keep the worst one
+        r.relocations = max(r.relocations, result->nRelocations());
+        r.nodes = max(r.nodes, Counters::total(Counters::nodes));
+    }
+    sort(times.begin(), times.end());
+    r.timeMin = times.front();
+    r.timeMedian = times[times.size() / 2];
+    r.nodesPerSecond = r.timeMedian > 0 ? r.nodes / r.timeMedian : 0;
+    r.peakRSS = 0;
+    return r;
+}
+
+// the peak RSS of a process never decreases, so each pair is run in a child
+// process whose own peak RSS is reported; the child sends its results back
+// as a csv line
+BenchResult runInChild(string instance, string method, string maxHeightType,
+                       shared_ptr<const SolverContext> context, int LB,
+                       int timeLimit, int warmup, int reps) {
+    int fds[2];
+    if ( pipe(fds) != 0 ) {
+        cerr << "cannot create a pipe" << endl;
+        exit(8);
+    }
+    cout.flush();
+    cerr.flush();
+    pid_t pid = fork();
+    if ( pid < 0 ) {
+        cerr << "cannot fork" << endl;
+        exit(8);
+    }
+    if ( pid == 0 ) {
+        close(fds[0]);
+        stringstream line;
+        writeCSV(line, run(instance, method, maxHeightType, context, LB,
+                           timeLimit, warmup, reps));
+        string data = line.str();
+        ssize_t written = write(fds[1], data.c_str(), data.size());
+        close(fds[1]);
+        _exit(written == (ssize_t) data.size() ? 0 : 8);
+    }
+    close(fds[1]);
+    string data;
+    char buffer[4096];
+    ssize_t n;
+    while ( (n = read(fds[0], buffer, sizeof(buffer))) > 0 ) {
+        data.append(buffer, n);
+    }
+    close(fds[0]);
+    int status;
+    struct rusage usage;
+    if ( wait4(pid, &status, 0, &usage) != pid || ! WIFEXITED(status) ||
+         WEXITSTATUS(status) != 0 || data.empty() ) {
+        cerr << "benchmark of " << method << " on " << instance
+             << " failed" << endl;
+        exit(WIFEXITED(status) && WEXITSTATUS(status) != 0 ?
+             WEXITSTATUS(status) : 8);
+    }
+    BenchResult r = readCSV(data);
+    // in kilobytes
+    r.peakRSS = usage.ru_maxrss;
+    return r;
+}
+
+int main(int argc, char **argv) {
+    vector<string> methods = { "LA-1", "SM-2", "SmSEQ-2", "JZW", "GLAH-1",
+                               "RS-5", "FM" };
+    vector<string> instances;
+    string maxHeightType = "H+2";
+    string ubMethod = "LA-1";
+    string hubMethod = "FM";
+    string format = "csv";
+    string outFile = "";
+    string baselineFile = "";
+    // relative slowdown tolerated before a time regression is reported
+    double tolerance = 0.1;
+    // slowdowns below this many seconds are timer noise
+    const double noiseFloor = 1e-3;
+    int timeLimit = 0;
+    int warmup = 1;
+    int reps = 3;
+    int LB = 1;
+
+    int i = 1;
+    while (i < argc) {
+        string tmp = argv[i];
+        if ( i + 1 >= argc ) {
+            cerr << "missing value for option: " << tmp << endl;
+            exit(5);
+        }
+        if (tmp == "-i") {
+            auto found = listInstances(argv[i+1]);
+            instances.insert(instances.end(), found.begin(), found.end());
+        } else if (tmp == "-m") {
+            methods = splitList(argv[i+1]);
+        } else if (tmp == "-maxHeight") {
+            maxHeightType = argv[i+1];
+        } else if (tmp == "-ub") {
+            ubMethod = argv[i+1];
+        } else if (tmp == "-hub") {
+            hubMethod = argv[i+1];
+        } else if (tmp == "-lb") {
+            LB = atoi(argv[i+1]);
+        } else if (tmp == "-tl") {
+            timeLimit = atoi(argv[i+1]);
+        } else if (tmp == "-reps") {
+            reps = max(1, atoi(argv[i+1]));
+        } else if (tmp == "-warmup") {
+            warmup = atoi(argv[i+1]);
+        } else if (tmp == "-format") {
+            format = argv[i+1];
+        } else if (tmp == "-o") {
+            outFile = argv[i+1];
+        } else if (tmp == "-baseline") {
+            baselineFile = argv[i+1];
+        } else if (tmp == "-tolerance") {
+            tolerance = atof(argv[i+1]);
+        } else {
+            cerr << "unrecognized option: " << tmp << endl;
+            exit(5);
+        }
+        i += 2;
+    }
+    if ( instances.empty() ) {
+        cerr << "no instance given, use -i <file or directory>" << endl;
+        exit(5);
+    }
+    if ( format != "csv" && format != "json" ) {
+        cerr << "unknown output format: " << format << endl;
+        exit(6);
+    }
+    // progress reports would be timed with the solvers
+    auto context = makeSolverContext(ubMethod, hubMethod, "tricoire", false,
+                                     true);
+
+    map<pair<string, string>, BenchResult> baseline;
+    if ( baselineFile != "" ) {
+        baseline = readBaseline(baselineFile);
+    }
+
+    // results go to their own file unless there is none
+    ofstream outStream;
+    if ( outFile != "" ) {
+        outStream.open(outFile);
+        if ( ! outStream ) {
+            cerr << "cannot write to " << outFile << endl;
+            exit(7);
+        }
+    }
+    ostream &out = outFile != "" ? outStream : cout;
+    stringstream results;
+    if ( format == "csv" ) {
+        results << csvHeader() << endl;
+    } else {
+        results << "[" << endl;
+    }
+
+    int nRegressions = 0;
+    bool first = true;
+    for (auto instance: instances) {
+        for (auto method: methods) {
+            BenchResult r = runInChild(instance, method, maxHeightType,
+                                       context, LB, timeLimit, warmup, reps);
+            if ( format == "csv" ) {
+                writeCSV(results, r);
+            } else {
+                writeJSON(results, r, first);
+            }
+            first = false;
+            auto it = baseline.find(make_pair(instance, method));
+            if ( it == baseline.end() ) {
+                continue;
+            }
+            const BenchResult &b = it->second;
+            if ( r.relocations > b.relocations ) {
+                cerr << "REGRESSION " << instance << " " << method
+                     << ": " << r.relocations << " relocations instead of "
+                     << b.relocations << endl;
+                nRegressions += 1;
+            }
+            if ( r.timeMedian > b.timeMedian * (1 + tolerance) &&
+                 r.timeMedian > b.timeMedian + noiseFloor ) {
+                cerr << "REGRESSION " << instance << " " << method
+                     << ": " << r.timeMedian << " s instead of "
+                     << b.timeMedian << " s" << endl;
+                nRegressions += 1;
+            }
+        }
+    }
+    if ( format == "json" ) {
+        results << endl << "]" << endl;
+    }
+    out << results.str();
+    if ( baselineFile != "" ) {
+        cerr << nRegressions << " regression(s) with respect to "
+             << baselineFile << endl;
+    }
+    return nRegressions > 0 ? 1 : 0;
+}
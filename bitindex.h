@@ -0,0 +1,114 @@
+#ifndef BITINDEX_H
+#define BITINDEX_H
+
+// ordered set of small integers, as a bitset with one summary bit per word
+// successor and predecessor queries look at a word and its summary word,
+// so they take constant time for the sizes of our bays (up to 4096 keys per
+// summary word); copies are a couple of small vectors
+
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+class BitIndex {
+public:
+    // empty set of keys 0..size-1
+    void reset(int size) {
+        size_ = size;
+        words_.assign((size + 63) / 64, 0);
+        summary_.assign((words_.size() + 63) / 64, 0);
+    }
+
+    void insert(int key) {
+        words_[key >> 6] |= bit(key);
+        summary_[key >> 12] |= bit(key >> 6);
+    }
+
+    void erase(int key) {
+        uint64_t &word = words_[key >> 6];
+        word &= ~bit(key);
+        if ( word == 0 ) {
+            summary_[key >> 12] &= ~bit(key >> 6);
+        }
+    }
+
+    bool contains(int key) const {
+        return words_[key >> 6] & bit(key);
+    }
+
+    // number of keys, in size / 64 steps
+    int count() const {
+        int result = 0;
+        for (auto word: words_) {
+            result += __builtin_popcountll(word);
+        }
+        return result;
+    }
+
+    // smallest key >= key, -1 if none
+    int successor(int key) const {
+        if ( key < 0 ) {
+            key = 0;
+        }
+        if ( key >= size_ ) {
+            return -1;
+        }
+        int w = key >> 6;
+        uint64_t word = words_[w] & (~0ULL << (key & 63));
+        if ( word != 0 ) {
+            return (w << 6) + __builtin_ctzll(word);
+        }
+        // next non-empty word
+        w += 1;
+        for (int s = w >> 6; s < summary_.size(); s++) {
+            uint64_t sum = summary_[s];
+            if ( s == w >> 6 ) {
+                sum &= (w & 63) == 0 ? ~0ULL : ~0ULL << (w & 63);
+            }
+            if ( sum != 0 ) {
+                w = (s << 6) + __builtin_ctzll(sum);
+                return (w << 6) + __builtin_ctzll(words_[w]);
+            }
+        }
+        return -1;
+    }
+
+    // largest key <= key, -1 if none
+    int predecessor(int key) const {
+        if ( key >= size_ ) {
+            key = size_ - 1;
+        }
+        if ( key < 0 ) {
+            return -1;
+        }
+        int w = key >> 6;
+        uint64_t word = words_[w] & (~0ULL >> (63 - (key & 63)));
+        if ( word != 0 ) {
+            return (w << 6) + 63 - __builtin_clzll(word);
+        }
+        // previous non-empty word
+        w -= 1;
+        for (int s = w >> 6; w >= 0 && s >= 0; s--) {
+            uint64_t sum = summary_[s];
+            if ( s == w >> 6 ) {
+                sum &= ~0ULL >> (63 - (w & 63));
+            }
+            if ( sum != 0 ) {
+                w = (s << 6) + 63 - __builtin_clzll(sum);
+                return (w << 6) + 63 - __builtin_clzll(words_[w]);
+            }
+        }
+        return -1;
+    }
+
+protected:
+    static uint64_t bit(int key) { return 1ULL << (key & 63); }
+
+    int size_ = 0;
+    vector<uint64_t> words_;
+    // bit w is set if words_[w] is not empty
+    vector<uint64_t> summary_;
+};
+
+#endif
@@ -4,8 +4,9 @@
 #include "branchandbound.h"
 #include "rakesearch.h"
 #include "petering.h"
+#include "counters.h"
+#include "dominance.h"
 
-extern unique_ptr<BRPPolicy> ubSolver;
 
 const int BranchAndBound::breadthFirst = 1;
 const int BranchAndBound::depthFirst = 2;
@@ -18,20 +19,23 @@ BranchAndBound::BranchAndBound(unsigned int UB,
     timeLimit_ = timeLimit;
 }
 
-shared_ptr<BRPState> BranchAndBound::solve(const BRPState &initialState) const {
-    clock_t startTicks = 0;
-    if (timeLimit_ > 0) {
-        startTicks = clock();
-    }
+shared_ptr<BRPState> BranchAndBound::solve(const BRPState &initialState,
+                                           const Deadline &callerDeadline)
+    const {
+    Deadline deadline = callerDeadline.capped(timeLimit_);
     // 
     deque<shared_ptr<BRPState> > Q;
     Q.push_back( make_shared<BRPState>(initialState));
     // unsigned int bestKnown = min(UB_, LA_N(1).solve(initialState));
     // storage of best solution
-    shared_ptr<BRPState> bestState = ubSolver->solve(initialState);
+    COUNT(heuristicRollouts);
+    shared_ptr<BRPState> bestState = restrictedIncumbent(
+        initialState, context().ubSolver->solve(initialState, deadline));
     unsigned int bestKnown = min(UB_, bestState->nRelocations());
+    DominanceFilter dominance;
+    size_t firstOp = initialState.operations().size();
     //
-    cout << "Starting " << explorationStrategy_
+    log() << "Starting " << explorationStrategy_
          << "-first branch-and-bound with LB = " << Q.back()->LB()
          << " and UB = " << bestKnown << endl;
     int strategy = -1;
@@ -45,20 +49,18 @@ shared_ptr<BRPState> BranchAndBound::solve(const BRPState &initialState) const {
         exit(22);
     }
     while (Q.size() > 0) {
-        // check for time limit if necessary
-        if (timeLimit_ > 0) {
-            if ( ((double) clock() - startTicks) / CLOCKS_PER_SEC > timeLimit_){
-                cout << "Branch-and-bound: time limit reached!" << endl;
-                int lowestLB = 1e9;
-                for (auto i : Q) {
-                    if (i->LB() + i->nRelocations() < lowestLB) {
-                        lowestLB = i->LB() + i->nRelocations();
-                    }
+        // check for time limit
+        if ( deadline.poll() ) {
+            log() << "Branch-and-bound: time limit reached!" << endl;
+            int lowestLB = 1e9;
+            for (auto i : Q) {
+                if (nodeLB(*i) + i->nRelocations() < lowestLB) {
+                    lowestLB = nodeLB(*i) + i->nRelocations();
                 }
-                cout << "current LB = " << lowestLB << endl;
-                cout << "Remaining nodes to process: " << Q.size() << endl;
-                return bestState;
             }
+            log() << "current LB = " << lowestLB << endl;
+            log() << "Remaining nodes to process: " << Q.size() << endl;
+            return bestState;
         }
         shared_ptr<BRPState> tmpState;
         if (strategy == breadthFirst) {
@@ -68,8 +70,11 @@ shared_ptr<BRPState> BranchAndBound::solve(const BRPState &initialState) const {
             tmpState = Q.back();
             Q.pop_back();
         }
+        COUNT_MAX(peakOpen, Q.size() + 1);
+        COUNT(nodes);
         // can we fathom this node?
-        if (tmpState->LB() + tmpState->nRelocations() >= bestKnown) {
+        if (nodeLB(*tmpState) + tmpState->nRelocations() >= bestKnown) {
+            COUNT(prunedByBound);
             continue;
         }
         // general case: we need to branch
@@ -82,7 +87,15 @@ shared_ptr<BRPState> BranchAndBound::solve(const BRPState &initialState) const {
                 bestState = tmpState;
             }
         } else { // Step 2: generate successors
-            for (unsigned int sFrom=0; sFrom < tmpState->W(); sFrom++) {
+            dominance.reset(*tmpState, context().dominanceRules, firstOp);
+            // in the restricted BRP, only the item above the next one moves
+            unsigned int firstFrom = 0;
+            unsigned int endFrom = tmpState->W();
+            if ( context().restricted ) {
+                firstFrom = tmpState->stackForItem(tmpState->next());
+                endFrom = firstFrom + 1;
+            }
+            for (unsigned int sFrom=firstFrom; sFrom < endFrom; sFrom++) {
                 // only relocate from stacks with at least one item and which
                 // are not the last stack we relocated to
                 if ( sFrom != tmpState->lastRelocatedTo() &&
@@ -111,7 +124,10 @@ shared_ptr<BRPState> BranchAndBound::solve(const BRPState &initialState) const {
                             int newBound = tmpState->nRelocations() + 1 +
                                 tmpState->LB() + fromDiff + toDiff;
                             // would that move be promising?
-                            if (newBound < bestKnown) {
+                            if (newBound < bestKnown &&
+                                dominance.dominated(*tmpState, sFrom, sTo)) {
+                                continue;
+                            } else if (newBound < bestKnown) {
                                 shared_ptr<BRPState> newState =
                                     make_shared<BRPState>(BRPState(*tmpState));
                                 newState->relocate(sFrom, sTo);
@@ -120,6 +136,8 @@ shared_ptr<BRPState> BranchAndBound::solve(const BRPState &initialState) const {
                                 if (newState->height(sTo) == 1) {
                                     relocatedToEmpty = true;
                                 }
+                            } else {
+                                COUNT(prunedAtBranching);
                             }
                         }
                     }
@@ -127,6 +145,6 @@ shared_ptr<BRPState> BranchAndBound::solve(const BRPState &initialState) const {
             }
         }
     }
-    cout << "Branch-and-bound is over" << endl;
+    log() << "Branch-and-bound is over" << endl;
     return bestState;
 }
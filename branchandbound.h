@@ -13,8 +13,12 @@ public:
                    string explorationStrategy,
                    unsigned int timeLimit);
     virtual string name() const { return "BranchAndBound"; }
+
+    virtual bool exact() const { return true; }
     
-    virtual shared_ptr<BRPState> solve(const BRPState &initialState) const;
+    virtual shared_ptr<BRPState>
+    solve(const BRPState &initialState,
+          const Deadline &deadline = Deadline()) const;
     
     static const int bestFirst;
     static const int breadthFirst;
@@ -0,0 +1,103 @@
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "brp_c.h"
+#include "genpolicy.h"
+
+using namespace std;
+
+struct brp_solver {
+    unique_ptr<BRPPolicy> policy;
+};
+
+brp_solver *brp_solver_new(const char *method, const char *ub_method,
+                           const char *hub_method) {
+    if ( method == NULL || ub_method == NULL || hub_method == NULL ||
+         ! validPolicyName(method) || ! validPolicyName(ub_method, true) ||
+         ! validPolicyName(hub_method, true) ) {
+        return NULL;
+    }
+    // no exception may reach a C caller
+    try {
+        // callers get the result, not the progress reports
+        auto context = makeSolverContext(ub_method, hub_method, "tricoire",
+                                         false, true);
+        auto solver = make_unique<brp_solver>();
+        solver->policy = genPolicy(method, context);
+        return solver.release();
+    } catch (...) {
+        return NULL;
+    }
+}
+
+void brp_solver_free(brp_solver *solver) {
+    delete solver;
+}
+
+static int solve(const brp_solver *solver, int w, const int *heights,
+                 const int *items, const char *max_height, int lb_version,
+                 double time_limit, int *moves, int max_moves, int *n_moves) {
+    *n_moves = 0;
+    if ( solver == NULL || w < 1 || heights == NULL || max_height == NULL ) {
+        return -1;
+    }
+    string maxHeightType = max_height;
+    if ( maxHeightType != "H+2" && maxHeightType != "2H-1" &&
+         maxHeightType != "unlimited" ) {
+        return -1;
+    }
+    int n = 0;
+    for (int s=0; s < w; s++) {
+        if ( heights[s] < 0 ) {
+            return -1;
+        }
+        n += heights[s];
+    }
+    if ( n > 0 && items == NULL ) {
+        return -1;
+    }
+    // items must be 1..n, each once
+    vector<vector<int> > stacks(w);
+    vector<bool> seen(n + 1, false);
+    for (int s=0, i=0; s < w; s++) {
+        for (int j=0; j < heights[s]; j++, i++) {
+            if ( items[i] < 1 || items[i] > n || seen[items[i]] ) {
+                return -1;
+            }
+            seen[items[i]] = true;
+            stacks[s].push_back(items[i]);
+        }
+    }
+    BRPState s(stacks, maxHeightType);
+    s.setLBVersion(lb_version);
+    if ( ! s.canRelocate() ) {
+        return -1;
+    }
+    // the policies expect items
+    auto result = s.empty() ? make_shared<BRPState>(s) :
+        solver->policy->solve(s, Deadline(time_limit));
+    auto &operations = result->operations();
+    if ( operations.size() > max_moves ) {
+        return -1;
+    }
+    for (auto op: operations) {
+        moves[2 * *n_moves] = op.first;
+        moves[2 * *n_moves + 1] = op.second;
+        *n_moves += 1;
+    }
+    return result->nRelocations();
+}
+
+int brp_solve(const brp_solver *solver, int w, const int *heights,
+              const int *items, const char *max_height, int lb_version,
+              double time_limit, int *moves, int max_moves, int *n_moves) {
+    // no exception may reach a C caller
+    try {
+        return solve(solver, w, heights, items, max_height, lb_version,
+                     time_limit, moves, max_moves, n_moves);
+    } catch (...) {
+        *n_moves = 0;
+        return -1;
+    }
+}
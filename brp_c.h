@@ -0,0 +1,40 @@
+#ifndef BRP_C_H
+#define BRP_C_H
+
+/* C interface to the solvers, for callers that cannot use the C++ one
+   (genPolicy() and makeSolverContext() in genpolicy.h) */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct brp_solver brp_solver;
+
+/* method, ub_method and hub_method are names as given to -m, -ub and -hub;
+   returns NULL if one of them is invalid or the solver cannot be built */
+brp_solver *brp_solver_new(const char *method, const char *ub_method,
+                           const char *hub_method);
+
+void brp_solver_free(brp_solver *solver);
+
+/* solve a bay of w stacks; stack s holds heights[s] items, given from bottom
+   to top, one stack after the other, in items; items are labelled 1..n
+   max_height is "H+2", "2H-1" or "unlimited"; time_limit is in seconds,
+   0 for none
+   moves receives the operations as (from, to) pairs, (from, from) being a
+   retrieval, so it must have room for 2 * max_moves ints; *n_moves is set
+   to the number of operations
+   returns the number of relocations, or -1 if the bay is invalid or cannot
+   be emptied (an item must be relocated but no other stack has room), if
+   max_moves is too small or if the solver failed
+   a solver must not be used by several threads at once, threads should
+   have their own */
+int brp_solve(const brp_solver *solver, int w, const int *heights,
+              const int *items, const char *max_height, int lb_version,
+              double time_limit, int *moves, int max_moves, int *n_moves);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
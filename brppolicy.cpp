@@ -1,11 +1,20 @@
 #include <iostream>
 
 #include "brppolicy.h"
+#include "counters.h"
 
 using namespace std;
 
+// no UB procedure, default settings
+BRPPolicy::BRPPolicy() {
+    static const shared_ptr<const SolverContext> defaultContext =
+        make_shared<SolverContext>();
+    context_ = defaultContext;
+}
+
 // return number of moves necessary to empty the bay
-shared_ptr<BRPState> BRPPolicy::solve(const BRPState &s1) const {
+shared_ptr<BRPState> BRPPolicy::solve(const BRPState &s1,
+                                      const Deadline &deadline) const {
     // cout << "Solving with " << name() << endl;
     BRPState state(s1);
     while (true) {
@@ -24,6 +33,19 @@ shared_ptr<BRPState> BRPPolicy::solve(const BRPState &s1) const {
     return make_shared<BRPState>(state);
 }
 
+shared_ptr<BRPState> BRPPolicy::improve(const BRPState &s1,
+                                        shared_ptr<BRPState> incumbent,
+                                        const Deadline &deadline) const {
+    if ( exact() ) {
+        incumbent = restrictedIncumbent(s1, incumbent);
+    }
+    shared_ptr<BRPState> result = solve(s1, deadline);
+    if ( incumbent->nRelocations() <= result->nRelocations() ) {
+        return incumbent;
+    }
+    return result;
+}
+
 // relocate container n as in LA heuristics
 void BRPPolicy::laRelocate(BRPState &state, unsigned int n) const {
     int bestS = bestDestForLaRelocate(state, n);
@@ -33,26 +55,12 @@ void BRPPolicy::laRelocate(BRPState &state, unsigned int n) const {
 // relocate container n as in LA heuristics
 unsigned int BRPPolicy::bestDestForLaRelocate(BRPState &state,
                                               unsigned int n) const {
-    int bestS = -1;
-    for (unsigned int s = 0; s < state.W(); s++) {
-        // cases that we can skip
-        if ( s == state.stackForItem(n) || state.height(s) == state.H() ) {
-            continue;
-        } else if ( bestS == -1 ) { // first valid stack we try
-            bestS = s;
-        } else if ( state.low(s) > n ) {
-            if ( state.low(bestS) < n ||
-                 ( state.low(bestS) > n && state.low(s) < state.low(bestS) ) ) {
-                // this is always an improvement
-                bestS = s;
-            }
-        } else if ( state.low(s) < n &&
-                    state.low(bestS) < n &&
-                    state.low(s) > state.low(bestS) ) {
-            // we generate a conflict but it will happen later than with the
-            // previous bestS
-            bestS = s;
-        }
+    int from = state.stackForItem(n);
+    // the stack with the smallest low above n, otherwise relocating n
+    // generates a conflict and it should happen as late as possible
+    int bestS = state.nonFullStackFrom(n + 1, from);
+    if ( bestS == -1 ) {
+        bestS = state.nonFullStackBelow(n, from);
     }
     return bestS;
 }
@@ -70,3 +78,25 @@ void BRPPolicy::forcedMove(BRPState &state) const {
 void BRPPolicy::autoRetrieve(BRPState &state) const {
     while (state.retrieveNext());
 }
+
+shared_ptr<BRPState>
+BRPPolicy::restrictedIncumbent(const BRPState &initialState,
+                               shared_ptr<BRPState> incumbent) const {
+    if ( ! context().restricted ) {
+        return incumbent;
+    }
+    BRPState state(initialState);
+    auto &ops = incumbent->operations();
+    for (size_t i = initialState.operations().size(); i < ops.size(); i++) {
+        if ( ops[i].first == ops[i].second ) {
+            state.retrieveNext();
+        } else if ( ops[i].first == state.stackForItem(state.next()) ) {
+            state.relocate(ops[i].first, ops[i].second);
+        } else {
+            // a voluntary move
+            COUNT(heuristicRollouts);
+            return BRPPolicy::solve(initialState);
+        }
+    }
+    return incumbent;
+}
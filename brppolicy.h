@@ -3,21 +3,53 @@
 
 #include <string>
 #include <iostream>
+#include <algorithm>
 
 #include "brpstate.h"
+#include "deadline.h"
+#include "solvercontext.h"
 
 using namespace std;
 
 class BRPPolicy {
 public:
-    BRPPolicy() { }
+    BRPPolicy();
 
     // return number of moves necessary to empty the bay
-    virtual shared_ptr<BRPState> solve(const BRPState &s1) const;
+    // search methods return the best solution found so far once deadline is
+    // reached; constructive heuristics such as this one always complete, as
+    // they are what the search methods fall back on
+    virtual shared_ptr<BRPState>
+    solve(const BRPState &s1,
+          const Deadline &deadline = Deadline()) const;
+
+    // solution at least as good as incumbent, a solution of s1 found
+    // beforehand; search methods start from it instead of their own UB, the
+    // others solve s1 and keep the better of both
+    virtual shared_ptr<BRPState>
+    improve(const BRPState &s1, shared_ptr<BRPState> incumbent,
+            const Deadline &deadline = Deadline()) const;
 
     virtual string name() const { return "base policy"; }
+
+    // true if solve() returns an optimal solution when it completes before
+    // its deadline
+    virtual bool exact() const { return false; }
+
+    // policies made of other policies pass the context on to them
+    virtual void setContext(shared_ptr<const SolverContext> context) {
+        context_ = context;
+    }
+
+    const SolverContext &context() const { return *context_; }
     
 protected:
+    shared_ptr<const SolverContext> context_;
+
+    // progress reports
+    ostream &log() const { return *context_->log; }
+
+
     // relocate container n as in LA heuristics
     void laRelocate(BRPState &s, unsigned int n) const;
 
@@ -37,6 +69,19 @@ protected:
     // retrieve items that can be retrieved
     void autoRetrieve(BRPState &state) const;
 
+    // for exact methods: incumbent, a solution of initialState, or if the
+    // context is restricted and incumbent is not, the forced moves of this
+    // policy, which are restricted
+    shared_ptr<BRPState> restrictedIncumbent(const BRPState &initialState,
+                                             shared_ptr<BRPState> incumbent)
+        const;
+
+    // for exact methods: LB of state, specialised for the restricted BRP
+    int nodeLB(const BRPState &state) const {
+        return context_->restricted ? max(state.LB(), state.restrictedLB()) :
+            state.LB();
+    }
+
 };
 
 #endif
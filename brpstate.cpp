@@ -2,11 +2,9 @@
 #include <fstream>
 #include <algorithm>
 #include <iomanip>
-#include <map>
 
 #include "brpstate.h"
-
-int BRPState::lbVersion;
+#include "counters.h"
 
 void BRPState::showOps() const {
     // cout << endl << endl << "OPs:" << endl;
@@ -19,11 +17,68 @@ void BRPState::showOps() const {
 }
 
 BRPState::BRPState(string fName, string maxHeightType) {
+    // W_, stacks_ and n_ are all initialised when reading the file
+    readFromFile(fName);
+    setMaxHeight(maxHeightType);
+}
+
+BRPState::BRPState(const vector<vector<int> > &stacks,
+                   string maxHeightType) {
+    int n = 0;
+    for (auto &stack: stacks) {
+        n += stack.size();
+    }
+    initEmpty(stacks.size(), n);
+    for (unsigned int s=0; s < W_; s++) {
+        for (auto item: stacks[s]) {
+            push(s, item);
+        }
+    }
+    setMaxHeight(maxHeightType);
+}
+
+BRPState::BRPState(int W, const uint16_t *heights, const uint16_t *items,
+                   string maxHeightType) {
+    int n = 0;
+    for (int s=0; s < W; s++) {
+        n += heights[s];
+    }
+    initEmpty(W, n);
+    for (int s=0; s < W; s++) {
+        for (int j=0; j < heights[s]; j++) {
+            push(s, *items++);
+        }
+    }
+    setMaxHeight(maxHeightType);
+}
+
+// W empty stacks, for n items
+void BRPState::initEmpty(int W, int n) {
+    W_ = W;
+    n_ = n;
     LB_ = 0;
     nRemaining_ = 0;
     lastRelocatedTo_ = -1;
-    // W_, stacks_ and n_ are all initialised when reading the file
-    readFromFile(fName);
+    lbVersion_ = 1;
+    next_ = 1;
+    nRelocations_ = 0;
+    stacks_.assign(W_, vector<int>());
+    low_.assign(W_, n_ + 1);
+    height_.assign(W_, 0);
+    mustBeMoved_.assign(n_ + 1, false);
+    stackForItem_.assign(n_ + 1, 0);
+    tier_.assign(n_ + 1, 0);
+    lowBelow_.assign(n_ + 1, 0);
+    run_.assign(n_ + 1, 0);
+    operations_.clear();
+    // no stack is indexed as not full until H_ is set
+    H_ = 0;
+    nonFull_.reset(n_ + 1 + W_);
+    badTops_.reset(n_ + 1);
+    badStacks_.reset(W_);
+}
+
+void BRPState::setMaxHeight(string maxHeightType) {
     unsigned int h = *max_element(height_.begin(), height_.end());
     if (maxHeightType == "unlimited") {
         H_ = n_;
@@ -37,40 +92,103 @@ BRPState::BRPState(string fName, string maxHeightType) {
         H_ = h;
         cerr << "\tH = " << H_ << endl;
     }
-    // meta-data section
-    next_ = 1;
-    nRelocations_ = 0;
-    // must be set properly
-    stackForItem_.resize(n_ + 1);
-    for (unsigned int s=0; s < W_; s++) {
-        for (vector<int>::const_iterator it = stacks_[s].begin();
-             it != stacks_[s].end();
-             it++) {
-            stackForItem_[*it] = s;
+    nonFull_.reset(n_ + 1 + W_);
+    for (int s=0; s < W_; s++) {
+        index(s);
+    }
+}
+
+void BRPState::unindex(int s) {
+    if ( height_[s] < H_ ) {
+        nonFull_.erase(stackKey(s));
+    }
+    if ( height_[s] > 0 && top(s) != low_[s] ) {
+        badTops_.erase(top(s));
+        badStacks_.erase(s);
+    }
+}
+
+void BRPState::index(int s) {
+    if ( height_[s] < H_ ) {
+        nonFull_.insert(stackKey(s));
+    }
+    if ( height_[s] > 0 && top(s) != low_[s] ) {
+        badTops_.insert(top(s));
+        badStacks_.insert(s);
+    }
+}
+
+int BRPState::nonFullStackFrom(int c, int except1, int except2) const {
+    if ( c > n_ + 1 ) {
+        return -1;
+    }
+    for (int key = nonFull_.successor(c); key >= 0;
+         key = nonFull_.successor(key + 1)) {
+        int s = keyStack(key);
+        if ( s != except1 && s != except2 ) {
+            return s;
+        }
+    }
+    return -1;
+}
+
+int BRPState::nonFullStackBelow(int c, int except1, int except2) const {
+    for (int key = nonFull_.predecessor(c > n_ + 1 ? n_ + W_ : c - 1);
+         key >= 0; key = nonFull_.predecessor(key - 1)) {
+        int s = keyStack(key);
+        if ( s != except1 && s != except2 ) {
+            return s;
+        }
+    }
+    return -1;
+}
+
+int BRPState::badTopUpTo(int from, int to, int except1, int except2) const {
+    for (int item = badTops_.predecessor(min(to, n_)); item >= from;
+         item = badTops_.predecessor(item - 1)) {
+        int s = stackForItem_[item];
+        if ( s != except1 && s != except2 ) {
+            return item;
         }
     }
+    return -1;
 }
 
 // read an instance by Caserta et al.
 void BRPState::readFromFile(string fName) {
     ifstream ifs;
     ifs.open(fName);
-    ifs >> W_ >> n_;
-    mustBeMoved_.resize(n_ + 1);
-    stackForItem_.resize(n_ + 1);
-    for (unsigned int i=0; i <= n_; i++) {
-        mustBeMoved_[i] = false;
-    }
+    if ( ! ifs ) {
+        cerr << "cannot read instance: " << fName << endl;
+        exit(10);
+    }
+    auto invalid = [&](string reason) {
+        cerr << "invalid instance " << fName << ": " << reason << endl;
+        exit(10);
+    };
+    int W, n;
+    if ( ! (ifs >> W >> n) || W < 1 || n < 0 ) {
+        invalid("expected the number of stacks and of items");
+    }
+    initEmpty(W, n);
     int thisH, tmp;
+    int nRead = 0;
+    vector<bool> seen(n + 1, false);
     for (unsigned int s=0; s < W_; s++) {
-        stacks_.push_back(vector<int>());
-        low_.push_back(n_ + 1);
-        height_.push_back(0);
-        ifs >> thisH;
+        if ( ! (ifs >> thisH) || thisH < 0 || nRead + thisH > n ) {
+            invalid("bad height for stack " + to_string(s));
+        }
         for (unsigned int j=0; j < thisH; j++) {
-            ifs >> tmp;
+            if ( ! (ifs >> tmp) || tmp < 1 || tmp > n || seen[tmp] ) {
+                invalid("items must be 1.." + to_string(n) + ", each once");
+            }
+            seen[tmp] = true;
             push(s, tmp);
         }
+        nRead += thisH;
+    }
+    if ( nRead != n ) {
+        invalid(to_string(nRead) + " items instead of " + to_string(n));
     }
     ifs.close();
 }
@@ -84,6 +202,8 @@ void BRPState::relocate(int fromStack, int toStack) {
         exit(9);
     }
     
+    unindex(fromStack);
+    unindex(toStack);
     // first, move item away from fromStack
     stacks_[fromStack].pop_back();
     height_[fromStack] -= 1;
@@ -91,13 +211,16 @@ void BRPState::relocate(int fromStack, int toStack) {
         if (height_[fromStack] == 0) {
             low_[fromStack] = n_ + 1;
         } else {
-            low_[fromStack] = *min_element( stacks_[fromStack].begin(),
-                                            stacks_[fromStack].end() );
+            low_[fromStack] = lowBelow_[stacks_[fromStack].back()];
         }
     } else if (low_[fromStack] <= item) {
         LB_ -= 1;
     }
     // next, push it into toStack
+    tier_[item] = height_[toStack];
+    lowBelow_[item] = min(item, low_[toStack]);
+    run_[item] = height_[toStack] > 0 && top(toStack) <= item ?
+        run_[top(toStack)] + 1 : 1;
     stacks_[toStack].push_back(item);
     height_[toStack] += 1;
     stackForItem_[item] = toStack;
@@ -108,6 +231,8 @@ void BRPState::relocate(int fromStack, int toStack) {
         mustBeMoved_[item] = true;
         LB_ += 1;
     }
+    index(fromStack);
+    index(toStack);
     // additional metadata
     nRelocations_ += 1;
     lastRelocatedTo_ = toStack;
@@ -117,6 +242,11 @@ void BRPState::relocate(int fromStack, int toStack) {
 
 // only use to generate data, not to move items
 void BRPState::push(int toStack, int item) {
+    unindex(toStack);
+    tier_[item] = height_[toStack];
+    lowBelow_[item] = min(item, low_[toStack]);
+    run_[item] = height_[toStack] > 0 && top(toStack) <= item ?
+        run_[top(toStack)] + 1 : 1;
     stacks_[toStack].push_back(item);
     stackForItem_[item] = toStack;
     nRemaining_ += 1;
@@ -127,17 +257,19 @@ void BRPState::push(int toStack, int item) {
         LB_ += 1;
     }
     height_[toStack] += 1;
+    index(toStack);
 }
 
 // only use to retrieve items, not to move them
 int BRPState::pop(int fromStack) {
     unsigned int item = stacks_[fromStack].back();
-    stacks_[fromStack].pop_back();
     if (item != next_) {
         cerr << "Error: retrieving item " << item
              << " but the next to be retrieved is " << next_ << endl;
         exit(9);
     }
+    unindex(fromStack);
+    stacks_[fromStack].pop_back();
     stackForItem_[item] = -1;
     next_ = item + 1;
     nRemaining_ -= 1;
@@ -146,12 +278,12 @@ int BRPState::pop(int fromStack) {
         if (height_[fromStack] == 0) {
             low_[fromStack] = n_ + 1;
         } else {
-            low_[fromStack] = *min_element( stacks_[fromStack].begin(),
-                                            stacks_[fromStack].end() );
+            low_[fromStack] = lowBelow_[stacks_[fromStack].back()];
         }
     } else {
         LB_ -= 1;
     }
+    index(fromStack);
     operations_.push_back(pair<int, int>(fromStack, fromStack) );
     // meta data
     lastRelocatedTo_ = -1;
@@ -167,28 +299,46 @@ int BRPState::remainingSlots(int stack) {
     return H_ - height_[stack];
 }
 
-// return stacks for lowest a items
-set<int> BRPState::stacksForLowestItems(int a) const {
-    set<int> result;
-    for (unsigned int i=next_; i < next_ + a; i++) {
-        result.insert(stackForItem_[i]);
-    }
-    return result;
-}
-
-// items on top of specified stacks
-vector<int> BRPState::tops(set<int> fromStacks) const {
-    vector<int> result;
-    for (auto s: fromStacks) {
-        result.push_back(top(s));
+int BRPState::stacksForLowestItems(int a, BitIndex &stacks) const {
+    stacks.reset(W_);
+    // stacks that are not full left out so far
+    int nOut = nNonFull();
+    int i = 0;
+    for (; i < a; i++) {
+        int s = stackForItem_[next_ + i];
+        if ( stacks.contains(s) ) {
+            continue;
+        }
+        if ( height_[s] < H_ ) {
+            if ( nOut == 1 ) {
+                break;
+            }
+            nOut -= 1;
+        }
+        stacks.insert(s);
     }
-    return result;
+    return i;
 }
 
 bool BRPState::empty() const {
     return next_ > n_;
 }
 
+bool BRPState::canRelocate() const {
+    for (int s=0; s < W_; s++) {
+        if ( nAboveLow(s) == 0 ) {
+            continue;
+        }
+        for (int t=0; t < W_; t++) {
+            if ( t != s && height_[t] < H_ ) {
+                return true;
+            }
+        }
+        return false;
+    }
+    return true;
+}
+
 bool BRPState::dominates(const BRPState &other) const {
     return (stacks_ == other.stacks_) && (nRelocations_ <= other.nRelocations_);
 }
@@ -262,17 +412,10 @@ bool BRPState::retrieveNext() {
 // all necessary relocates
 shared_ptr<vector<pair<int, int> > > BRPState::necessaryRelocates() const {
     auto result = make_shared<vector<pair<int, int> > >();
-    for (int s=0; s < W(); s++) {
-        if ( height_[s] > 1 ) {
-            int item = top(s);
-            for (int i=0; i < height_[s] - 1; i++) {
-                // item on top of a smaller item: we need to relocate
-                if (item > stacks_[s][i]) {
-                    result->push_back(make_pair(s, item));
-                    break;
-                }
-            }
-        }
+    // item on top of a smaller item: we need to relocate
+    for (int s = badStacks_.successor(0); s >= 0;
+         s = badStacks_.successor(s + 1)) {
+        result->push_back(make_pair(s, top(s)));
     }
     return result;
 }
@@ -299,50 +442,13 @@ safeRelocates(shared_ptr<vector<pair<int, int> > > relocates) const {
 }
 
 // all safe 2-relocates
-shared_ptr<vector<tuple<int, int, int> > > BRPState::
-safe2Relocates(shared_ptr<vector<pair<int, int> > > relocates) const {
-    if (relocates == NULL) {
-        relocates = necessaryRelocates();
-    }
-    int highEnough = n_ << 2;
+shared_ptr<vector<tuple<int, int, int> > > BRPState::safe2Relocates() const {
     auto result = make_shared<vector<tuple<int, int, int> > >();
     for (unsigned int sTo = 0; sTo < W_; sTo++) {
-        int bestDiff = highEnough;
-        int bestTo = -1;
-        int bestToTo = -1;
-        for (auto reloc: *relocates) {
-            // only relocate to different stacks
-            if (sTo != reloc.first && height_[sTo] > 0 &&
-                top(sTo) < reloc.second) {
-                int item3;
-                if (height_[sTo] > 1) {
-                    item3 = *(min_element( stacks_[sTo].begin(),
-                                           stacks_[sTo].end()-1 ));
-                } else {
-                    item3 = n_ + 1;
-                }
-                // interesting case
-                if (item3 >= reloc.second) {
-                    vector<pair<int, int> > tmp = { make_pair(sTo, top(sTo)) };
-                    auto sr =
-                        bestSafeRelocate( make_shared<vector<
-                                          pair<int, int> > > (tmp) );
-                    // there exists a feasible safe 1-relocate
-                    if (get<0>(sr) >= 0) {
-                        // is it better than the best found so far for moving
-                        // top(sTo)?
-                        int diff = item3 - reloc.second + get<2>(sr);
-                        if (diff < bestDiff) {
-                            bestDiff = diff;
-                            bestTo = sTo;
-                            bestToTo = get<1>(sr);
-                        }
-                    }
-                }
-            }
-        }
-        if (bestTo > -1) {
-            result->push_back( make_tuple( bestTo, bestToTo, bestDiff ) );
+        int diff;
+        int toTo = safe2RelocateVia(sTo, diff);
+        if (toTo > -1) {
+            result->push_back( make_tuple( sTo, toTo, diff ) );
         }
     }
     return result;
@@ -350,20 +456,24 @@ safe2Relocates(shared_ptr<vector<pair<int, int> > > relocates) const {
 
 tuple<int, int, int> BRPState::
 bestSafeRelocate(shared_ptr<vector<pair<int, int> > > relocates) const {
-    if (relocates == NULL) {
-        relocates = necessaryRelocates();
-    }
     tuple<int, int, int> best = make_tuple(-1, -1, n_ + 1);
-    for (auto reloc: *relocates) {
-        for (unsigned int sTo = 0; sTo < W_; sTo++) {
-            // only relocate to different stacks
-            if (sTo != reloc.first && height_[sTo] < H_ &&
-                low_[sTo] >= reloc.second &&
-                low_[sTo] - reloc.second < get<2>(best)) {
-                get<0>(best) = reloc.first;
-                get<1>(best) = sTo;
-                get<2>(best) = low_[sTo] - reloc.second;
-            }
+    auto consider = [&](int from, int item) {
+        // only relocate to different stacks
+        int sTo = nonFullStackFrom(item, from);
+        if (sTo != -1 && low_[sTo] - item < get<2>(best)) {
+            get<0>(best) = from;
+            get<1>(best) = sTo;
+            get<2>(best) = low_[sTo] - item;
+        }
+    };
+    if (relocates == NULL) {
+        for (int s = badStacks_.successor(0); s >= 0;
+             s = badStacks_.successor(s + 1)) {
+            consider(s, top(s));
+        }
+    } else {
+        for (auto reloc: *relocates) {
+            consider(reloc.first, reloc.second);
         }
     }
     return best;
@@ -415,51 +525,49 @@ bestSafeRelocate(shared_ptr<vector<pair<int, int> > > relocates) const {
 // }
 
 tuple<int, int, int> BRPState::bestSafe2Relocate() const {
-    auto relocates = necessaryRelocates();
     int highEnough = n_ << 2;
     int bestDiff = highEnough;
     int bestTo = -1;
     int bestToTo = -1;
     for (unsigned int sTo = 0; sTo < W_; sTo++) {
-        for (auto reloc: *relocates) {
-            // only relocate to different stacks
-            if (sTo != reloc.first && height_[sTo] > 0 &&
-                top(sTo) < reloc.second) {
-                int item3;
-                if (height_[sTo] > 1) {
-                    item3 = *(min_element( stacks_[sTo].begin(),
-                                           stacks_[sTo].end()-1 ));
-                } else {
-                    item3 = n_ + 1;
-                }
-                // interesting case
-                if (item3 >= reloc.second) {
-                    vector<pair<int, int> > tmp = { make_pair(sTo, top(sTo)) };
-                    auto sr =
-                        bestSafeRelocate( make_shared<vector<
-                                          pair<int, int> > > (tmp) );
-                    // there exists a feasible safe 1-relocate
-                    if (get<0>(sr) >= 0) {
-                        // is it better than the best found so far for moving
-                        // top(sTo)?
-                        int diff = item3 - reloc.second + get<2>(sr);
-                        if (diff < bestDiff) {
-                            bestDiff = diff;
-                            bestTo = sTo;
-                            bestToTo = get<1>(sr);
-                        }
-                    }
-                }
-            }
+        int diff;
+        int toTo = safe2RelocateVia(sTo, diff);
+        // is it better than the best found so far?
+        if (toTo > -1 && diff < bestDiff) {
+            bestDiff = diff;
+            bestTo = sTo;
+            bestToTo = toTo;
         }
     }
     return make_tuple( bestTo, bestToTo, bestDiff );
 }
 
+// the best safe 2-relocate through sTo moves the largest badly placed item
+// that sTo can take once its top is gone, the top going to its best safe
+// destination
+int BRPState::safe2RelocateVia(int sTo, int &diff) const {
+    if (height_[sTo] == 0) {
+        return -1;
+    }
+    // smallest item left in sTo without its top
+    int item3 = height_[sTo] > 1 ? f(sTo) : n_ + 1;
+    int item = badTopUpTo(top(sTo) + 1, item3, sTo);
+    if (item == -1) {
+        return -1;
+    }
+    int toTo = nonFullStackFrom(top(sTo), sTo);
+    if (toTo == -1) {
+        return -1;
+    }
+    diff = item3 - item + low_[toTo] - top(sTo);
+    return toTo;
+}
+
 // undo the last operation (retrieval or relocate)
 // pre-condition: operations_ is not empty
 // caveat: lastRelocatedTo_ is set to -1
 void BRPState::undoLastMove() {
+    COUNT(relocationsUndone);
     pair<int, int> lastOp = operations_.back();
     operations_.pop_back();
     if ( lastOp.first == lastOp.second ) { // case 1: retrieval
@@ -483,12 +591,13 @@ void BRPState::displaySolution() const {
         } else {
             cout << "Relocate from " << op.first << " to " << op.second;
         }
-        cout << "\t(" << i++ << ")" << endl;
+        cout << "\t(" << i++ << ")\n";
     }
+    cout << flush;
 }
 
 int BRPState::LB() const {
-    switch (lbVersion) {
+    switch (lbVersion_) {
        case 1:
            return LB1();
        case 2:
@@ -502,36 +611,32 @@ int BRPState::LB() const {
     }
 }
 
-clock_t ticksInLB1 = 0;
-clock_t ticksInLB2 = 0;
-clock_t ticksInLB3 = 0;
-map<int, long long> countForGap;
+int BRPState::restrictedLB() const {
+    if ( nRemaining_ == 0 ) {
+        return LB_;
+    }
+    int s = stackForItem_[next_];
+    // the other stacks only receive items until next_ is retrieved, so
+    // their lows can only decrease
+    int best = nonFullStackBelow(n_ + 2, s);
+    int maxLow = best == -1 ? 0 : low_[best];
+    int result = LB_;
+    for (int t = tier_[next_] + 1; t < height_[s]; t++) {
+        if ( stacks_[s][t] > maxLow ) {
+            result += 1;
+        }
+    }
+    return result;
+}
 
 int BRPState::LBcomp() const {
     int lb1, lb2, lb3;
-    clock_t before, after;
-    //
-    before = clock();
     lb1 = LB1();
-    after = clock();
-    ticksInLB1 += after - before;
-    //
-    before = clock();
     lb2 = LB2();
-    after = clock();
-    ticksInLB2 += after - before;
-    //
-    before = clock();
     lb3 = LB3();
-    after = clock();
-    ticksInLB3 += after - before;
     // cout << "LB1=" << lb1 << "\tLB2=" << lb2 << "\tLB3=" << lb3 << endl;
     int gap = lb3 - lb1;
-    if ( countForGap.find(gap) == countForGap.end() ) {
-        countForGap[gap] = 1;
-    } else {
-        countForGap[gap] += 1;
-    }
+    COUNT_AT(lbGap, min(gap, Counters::gapBuckets - 1));
     // if (lb1 != lb2) {
     //     cout << *this;
     //     cout << endl << "[return] to continue" << endl;
@@ -541,10 +646,12 @@ int BRPState::LBcomp() const {
 }
 
 int BRPState::LB1() const {
+    COUNT(lb1);
     return LB_;
 }
 
 int BRPState::LB2() const {
+    COUNT(lb2);
     int minTop = n_ + 1;
     int maxMin = 0;
     for (unsigned int s=0; s < W_; s++) {
@@ -567,6 +674,7 @@ int BRPState::LB2() const {
 }
 
 int BRPState::LB3() const {
+    COUNT(lb3);
     // cout << "###############################" << endl;    
     // what is the height of the shortest stack?
     int shortestHeight = H_;
@@ -616,59 +724,53 @@ int BRPState::lowestExceptTopK(unsigned int s, unsigned int k) const {
              << stacks_[s].size() << " items" << endl;
         exit(22);
     }
-    if ( k == 0 ) {
-        return low_[s];
-    } else {
-        for ( unsigned int i=0; i < k; i++ ) {
-            // case where the current min is within the k top elements:
-            // compute the min of the remaining elements
-            if ( *(stacks_[s].rbegin() + i) == low_[s] ) {
-                return *(min_element( stacks_[s].begin(),
-                                      stacks_[s].end()-k ));
-            }
-        }
-        // if we reach this point, the current min is not within the top k items
-        return low_[s];
-    }
+    return lowestUpTo(s, height_[s] - 1 - k);
 }
 
-void BRPState::writeInstanceToFile(string fName) const {
-    ofstream ofs;
-    ofs.open(fName, ofstream::out);
-    ofs << "instance BRPData(W=" << W_ << ", H=" << H_ << ", n=" << n_
-        << ", stacks=[";
-    for (auto s: stacks_) {
-        ofs << "[";
+void BRPState::writeInstance(ostream &os) const {
+    os << "instance BRPData(W=" << W_ << ", H=" << H_ << ", n=" << n_
+       << ", stacks=[";
+    for (auto &s: stacks_) {
+        os << "[";
         for (auto i: s) {
-            ofs << i << ", ";
+            os << i << ", ";
         }
-        ofs << "], ";
+        os << "], ";
     }
-    ofs << "])" << endl;
-    ofs.close();
+    os << "])\n";
 }
 
-void BRPState::appendSolutionToFile(string fName) const {
-    ofstream ofs;
-    ofs.open(fName, ofstream::out | ofstream::app);
+void BRPState::writeSolution(ostream &os) const {
     unsigned int t = 1;
     unsigned int i=0;
     for (auto op: operations_) {
         if (op.first == op.second) {
-            ofs << "retrieving " << t++ << " from " << op.first << "\t";
+            os << "retrieving " << t++ << " from " << op.first << "\t";
         } else {
-            ofs << "relocating x from " << op.first << " to " << op.second;
+            os << "relocating x from " << op.first << " to " << op.second;
         }
-        ofs << "\t(" << i++ << ")" << endl;
+        os << "\t(" << i++ << ")\n";
     }
+}
+
+void BRPState::writeInstanceToFile(string fName) const {
+    ofstream ofs;
+    ofs.open(fName, ofstream::out);
+    writeInstance(ofs);
+    ofs.close();
+}
+
+void BRPState::appendSolutionToFile(string fName) const {
+    ofstream ofs;
+    ofs.open(fName, ofstream::out | ofstream::app);
+    writeSolution(ofs);
     ofs.close();    
 }
 
 // minimum index of all items in stack s except its top item
 int BRPState::f(unsigned int s) const{
-    if (low_[s] == top(s)) {
-        return *(min_element( stacks_[s].begin(),
-                              stacks_[s].end()-1 ));
+    if (low_[s] == top(s) && height_[s] > 1) {
+        return lowestUpTo(s, height_[s] - 2);
     } else {
         return low_[s];
     }
@@ -677,12 +779,9 @@ int BRPState::f(unsigned int s) const{
 // minimum index of all items in stack s except its top item
 int BRPState::smallestAbove(int c) const {
     int smallest = n_ + 1;
-    auto it = stacks_[stackForItem_[c]].rbegin();
-    while ( *it != c ) {
-        if ( *it < smallest ) {
-            smallest = *it;
-        }
-        ++it;
+    const vector<int> &stack = stacks_[stackForItem_[c]];
+    for (int t = tier_[c] + 1; t < stack.size(); t++) {
+        smallest = min(smallest, stack[t]);
     }
     if (smallest == n_ + 1) {
         cerr << "Error in smallestAbove" << endl;
@@ -690,329 +789,3 @@ int BRPState::smallestAbove(int c) const {
     }
     return smallest;
 }
-
-void BRPState::condenseTricoire() {
-    while(true) {
-        int sizeBefore = nRelocations();
-        condenseTricoireSub();
-        if (sizeBefore == nRelocations()) {
-            break;
-        }
-    }
-}
-
-void BRPState::condenseJin() {
-    while(true) {
-        int sizeBefore = nRelocations();
-        condenseJinSub();
-        if (sizeBefore == nRelocations()) {
-            break;
-        }
-    }
-}
-
-void BRPState::condenseTricoireSub() {
-    int firstReloc = 0;
-    // compute height of each stack at each op
-    vector<vector<int> > heightBeforeOp(operations_.size() + 1,
-                                        vector<int>(W_, n_ / W_) );
-    for (int op = 0; op < operations_.size(); op++) {
-        int from = operations_[op].first;
-        int to = operations_[op].second;
-        for (int s=0; s < W_; s++) {
-            if ( s == from ) {
-                heightBeforeOp[op+1][s] = heightBeforeOp[op][s] - 1;
-            } else if ( s == to && from != to ) {
-                heightBeforeOp[op+1][s] = heightBeforeOp[op][s] + 1;
-            } else {
-                heightBeforeOp[op+1][s] = heightBeforeOp[op][s];
-            }
-        }
-    }
-    // now try to condense
-    while (firstReloc < nRelocations_ - 1) {
-        int s1 = operations_[firstReloc].first;
-        int s2 = operations_[firstReloc].second;
-        // special case: retrieval
-        if (s1 == s2) {
-            firstReloc += 1;
-            continue;
-        }
-        int secondReloc = firstReloc + 1;
-        while (secondReloc < nRelocations_) {            
-            if (operations_[secondReloc].first == // it's a retrieval
-                operations_[secondReloc].second) {
-                secondReloc += 1;
-                continue;
-            }
-            // can these two be possibly condensed?
-            if ( s2 == operations_[secondReloc].first ) {
-                int s3 = operations_[secondReloc].second;
-
-                // cout << endl << endl;
-                // cout << "firstReloc = " << firstReloc << endl;
-                // cout << "secondReloc = " << secondReloc << endl;
-                // cout << "s1 = " << s1 << endl;
-                // cout << "s2 = " << s2 << endl;
-                // cout << "s3 = " << s3 << endl << endl;
-                
-                // if ( nRelocations_ == 4825
-                //      && firstReloc == 98
-                //      && secondReloc > 125 ) {
-                //     cout << "!!!" << endl;
-                //     exit(9);
-                // }
-                
-                // stack is full at this point
-                if ( s1 != s3 && heightBeforeOp[firstReloc][s3] == H_ ) {
-                    secondReloc += 1;
-
-                    // cout << "STOP 1" << endl;
-                    
-                    continue;
-                }
-                // maybe they can!
-                bool canBeCondensed = true;
-                // we keep track of how many items are above the item
-                // which has been relocated in firstReloc
-                // we refer to this item as 'C'
-                int aboveC = 0;
-                int aboveS3 = 0;
-                for ( int i = firstReloc + 1; i < secondReloc; i++ ) {
-                    // special case 1: C is retrieved or moved
-                    if ( aboveC == 0 &&
-                         operations_[i].first == s2 ) {
-
-                        // cout << "STOP 2" << endl;
-                    
-                        canBeCondensed = false;
-                        break;
-                    } else {
-                        // special case 2: adding on top of C
-                        if ( operations_[i].first != s2
-                             && operations_[i].second == s2) {
-                            aboveC += 1;
-                        }
-                        // special case 3: removing an item above C
-                        if (operations_[i].first == s2) {
-                            aboveC -= 1;
-                            if (aboveC < 0) {
-                                cerr << "This should not happen!" << endl;
-                                exit(8);
-                            }
-                        }
-                        // special case 4: retrieving an item from s3
-                        if ( operations_[i].second == s3 ) {
-                            if ( operations_[i].first == s3 ) {
-                                canBeCondensed = false;
-
-                                // cout << "STOP 3" << endl;
-                    
-                                break;
-                            } else {
-                                // special case 5: one more item on s3
-                                aboveS3 += 1;
-                                // if there was only one free spot it is also
-                                // infeasible to condense, because this means
-                                // s3 is being used as buffer stack and it
-                                // won't be possible any more after condensation
-                                if (aboveS3 + heightBeforeOp[i][s3] >= H_ - 1) {
-                                    // case where condensing will cause
-                                    // infeasibility due to height limit
-                                    canBeCondensed = false;
-
-                                    // cout << "STOP 4" << endl;
-                    
-                                    break;
-                                }
-                            }
-                        }
-                        // special case 6: one less item on final
-                        // destination of C
-                        if ( operations_[i].first == s3 ) {
-                            aboveS3 -= 1;
-                            if (aboveS3 < 0) {
-                                canBeCondensed = false;
-
-                                // cout << "STOP 5" << endl;
-                    
-                                break;
-                            }
-                        }
-                    }
-                }
-                // final check: would a condensation make no difference?
-                if ( aboveS3 != 0 || aboveC != 0 ) {
-
-                    // cout << "STOP 6" << endl;
-                        
-                    canBeCondensed = false;
-                }
-                if (canBeCondensed) {
-                    // condense ftw!
-                    // cout << "condensing!!!" << endl;
-                    // cout << "BEFORE: " << endl;
-                    // displaySolution();
-                    // cout << endl;
-                    // cout << "firstReloc = " << firstReloc << endl;
-                    // cout << "secondReloc = " << secondReloc << endl;
-                    // cout << "s1 = " << s1 << endl;
-                    // cout << "s2 = " << s2 << endl;
-                    // cout << "s3 = " << s3 << endl << endl;
-                    
-                    // cout << "s1 = " << operations_[firstReloc].first << endl;
-                    // cout << "s2 = " << operations_[firstReloc].second << endl;
-                    // cout << "s2 = " << operations_[secondReloc].first << endl;
-                    // cout << "s3 = " << operations_[secondReloc].second << endl;
-                    for ( int i = firstReloc + 1; i < secondReloc; i++ ) {
-                        heightBeforeOp[i][s2] -= 1;
-                        heightBeforeOp[i][s3] += 1;
-                    }
-                    heightBeforeOp.erase(heightBeforeOp.begin() +
-                                         secondReloc);
-                    operations_.erase(operations_.begin() + secondReloc);
-                    nRelocations_ -= 1;
-                    operations_[firstReloc].second = s3;
-                    s2 = s3;
-                    // special case: moving back and forth
-                    if ( s1 == s3 ) {
-                        heightBeforeOp.erase(heightBeforeOp.begin() +
-                                             firstReloc);
-                        operations_.erase(operations_.begin() + firstReloc);
-                        nRelocations_ -= 1;
-                        // firstReloc += 1;
-                        while (operations_[firstReloc].first ==
-                               operations_[firstReloc].second) {
-                            firstReloc += 1;
-                        }
-                        s1 = operations_[firstReloc].first;
-                        s2 = operations_[firstReloc].second;
-                        secondReloc = firstReloc + 1;
-                    }
-                    
-                    // secondReloc = firstReloc;
-                    // firstReloc = 0;
-
-                    // cout << "AFTER:" << endl;
-                    // displaySolution();
-                    // cout << endl;
-                    
-                } else {
-                    secondReloc += 1;
-                }
-            } else {
-                secondReloc += 1;
-            }
-        }
-        firstReloc += 1;
-    }
-}
-
-void BRPState::condenseJinSub() {
-    int firstReloc = 0;
-    // now try to condense
-    while (firstReloc < nRelocations_ - 1) {
-        while (operations_[firstReloc].first ==
-               operations_[firstReloc].second) {
-            firstReloc += 1;
-        }
-        int s1 = operations_[firstReloc].first;
-        int s2 = operations_[firstReloc].second;
-        int secondReloc = firstReloc + 1;
-        while (secondReloc < nRelocations_) {
-            if ( operations_[secondReloc].first ==
-                 operations_[secondReloc].second ) {
-                secondReloc += 1;
-                continue;
-            }
-            // can these two be possibly condensed?
-            if ( operations_[firstReloc].second ==
-                 operations_[secondReloc].first ) {
-                int s3 = operations_[secondReloc].second;
-                // maybe they can!
-                bool canBeCondensed = true;
-                // we keep track of how many items are above the item
-                // which has been relocated in firstReloc
-                // we refer to this item as 'C'
-                int aboveC = 0;
-                for ( int i = firstReloc + 1; i < secondReloc; i++ ) {
-                    // special case 1: C is retrieved or moved
-                    if ( aboveC == 0 &&
-                         operations_[i].first == s2 ) {
-                        canBeCondensed = false;
-                        break;
-                    } else {                        
-                        // special case 2: adding on top of C
-                        if ( operations_[i].first != s2
-                             && operations_[i].second == s2 ) {
-                            aboveC += 1;
-                        }
-                        // special case 3: removing an item above C
-                        if (operations_[i].first == s2) {
-                            aboveC -= 1;
-                            if (aboveC < 0) {
-                                cerr << "This should not happen!" << endl;
-                                exit(8);
-                            }
-                        }
-                        // special case 4: touching destination stack
-                        if ( operations_[i].first == s3 ||
-                             operations_[i].second == s3 ) {
-                            canBeCondensed = false;
-                            break;
-                        }
-                    }
-                }
-                // final check: is C still on top?
-                if ( aboveC != 0 ) {
-                    canBeCondensed = false;
-                }
-                if (canBeCondensed) {
-                    // condense ftw!
-
-                    // cout << "condensing!!!" << endl;
-                    // // displaySolution();
-                    // cout << "firstReloc = " << firstReloc << endl;
-                    // cout << "secondReloc = " << secondReloc << endl;
-                    // cout << "s1 = " << s1 << endl;
-                    // cout << "s2 = " << s2 << endl;
-                    // cout << "s3 = " << s3 << endl;
-                    
-                    // writeInstanceToFile("before.txt");
-                    // appendSolutionToFile("before.txt");
-
-                    operations_.erase(operations_.begin() + secondReloc);
-                    nRelocations_ -= 1;
-                    operations_[firstReloc].second = s3;
-                    s2 = s3;
-                    // special case: moving back and forth
-                    if ( s1 == s3 ) {
-                        operations_.erase(operations_.begin() + firstReloc);
-                        nRelocations_ -= 1;
-                        // firstReloc += 1;
-                        while (operations_[firstReloc].first ==
-                               operations_[firstReloc].second) {
-                            firstReloc += 1;
-                        }
-                        s1 = operations_[firstReloc].first;
-                        s2 = operations_[firstReloc].second;
-                        secondReloc = firstReloc + 1;
-                    }
-
-                    // cout << "ops after condensation: " << endl;
-                    // displaySolution();
-
-                    // writeInstanceToFile("after.txt");
-                    // appendSolutionToFile("after.txt");
-                    // secondReloc = firstReloc;
-                    // firstReloc = 0;
-                } else {
-                    secondReloc += 1;
-                }
-            } else {
-                secondReloc += 1;
-            }
-        }
-        firstReloc += 1;
-    }
-}
@@ -6,6 +6,10 @@
 #include <string>
 #include <memory>
 #include <iostream>
+#include <cstdint>
+
+#include "deadline.h"
+#include "bitindex.h"
 
 using namespace std;
 
@@ -13,8 +17,21 @@ class BRPState {
 public:
     BRPState(string fName, string maxHeightType);
 
+    // stacks are given from bottom to top, items are labelled 1..n
+    BRPState(const vector<vector<int> > &stacks, string maxHeightType);
+
+    // W stacks, stack s holding heights[s] items; the items of all stacks
+    // follow each other in items, as in an instance archive
+    BRPState(int W, const uint16_t *heights, const uint16_t *items,
+             string maxHeightType);
+
+    // read an instance by Caserta et al.; exits if the file cannot be read
+    // or is not a valid instance
     void readFromFile(string fName);
 
+    // script format: the instance on one line, then one line per operation
+    void writeInstance(ostream &os) const;
+    void writeSolution(ostream &os) const;
     void writeInstanceToFile(string fName) const;
     void appendSolutionToFile(string fName) const;
     
@@ -36,16 +53,45 @@ public:
 
     int remainingSlots(int stack);
 
-    // return stacks for lowest a items
-    set<int> stacksForLowestItems(int a) const;
+    // stacks of the lowest items next(), next() + 1..., up to a items or
+    // until only one of the stacks that are not full is left out
+    // stacks is reset to W keys, so it does not allocate once it has been
+    // used for this bay; returns the number of items
+    int stacksForLowestItems(int a, BitIndex &stacks) const;
 
     unsigned int stackForItem(const int i) const { return stackForItem_[i]; }
-    
-    // items on top of specified stacks
-    vector<int> tops(set<int> fromStacks) const;
 
+    // tier of item i in its stack, 0 at the bottom
+    int tier(int i) const { return tier_[i]; }
+
+    // number of items above item i
+    int depth(int i) const {
+        return height_[stackForItem_[i]] - 1 - tier_[i];
+    }
+
+    // number of items above the next item to retrieve from stack s
+    int nAboveLow(unsigned int s) const {
+        return height_[s] > 0 ? depth(low_[s]) : 0;
+    }
+
+    // length of the (non strictly) decreasing sequence of items from the
+    // top of stack s down
+    int topRun(unsigned int s) const {
+        return height_[s] > 0 ? run_[top(s)] : 0;
+    }
+
+    // minimum index of the items of stack s at tiers 0..t
+    int lowestUpTo(unsigned int s, int t) const {
+        return lowBelow_[stacks_[s][t]];
+    }
+    
     bool empty() const;
 
+    // false if a stack holds an item above a smaller one while no other
+    // stack has room, so that the bay cannot be emptied; solvers assume
+    // this does not happen
+    bool canRelocate() const;
+
     int next() const {return next_; }
 
     int n() const {return n_; }
@@ -61,6 +107,11 @@ public:
     int LB2() const;
     int LB3() const;
     int LBcomp() const;
+    // bound of the restricted BRP, where only the items above the next one
+    // are relocated: LB1 plus those of them that are larger than the low
+    // of every other stack that is not full, as they block again once
+    // relocated
+    int restrictedLB() const;
 
     // minimum index of all items in stack s except its top item
     int f(unsigned int s) const;
@@ -68,13 +119,29 @@ public:
     // minimum index of all items in stack s except its top k items
     int lowestExceptTopK(unsigned int s, unsigned int k) const;
 
-    // which LB are we using?
-    static int lbVersion;
+    // which LB are we using? Copies use the same one
+    int lbVersion() const { return lbVersion_; }
+    void setLBVersion(int version) { lbVersion_ = version; }
     
     int height(unsigned int s) const { return height_[s]; }
 
     int low(unsigned int s) const { return low_[s]; }
 
+    // ordered queries over the stacks that are not full, by (low, stack),
+    // empty stacks coming last by increasing index; except1 and except2 are
+    // skipped. -1 if there is no such stack
+    // the first stack with the smallest low >= c
+    int nonFullStackFrom(int c, int except1 = -1, int except2 = -1) const;
+    // the last stack with the largest low < c; any low if c > n + 1
+    int nonFullStackBelow(int c, int except1 = -1, int except2 = -1) const;
+    // number of stacks that are not full
+    int nNonFull() const { return nonFull_.count(); }
+
+    // the largest item in [from, to] that is on top of a stack holding a
+    // smaller item, except on stacks except1 and except2; -1 if none
+    int badTopUpTo(int from, int to, int except1 = -1,
+                   int except2 = -1) const;
+
     unsigned int nRelocations() const { return nRelocations_; }
 
     unsigned int nRemaining() const { return nRemaining_; }
@@ -83,6 +150,9 @@ public:
     
     const vector<vector<int> > &stacks() const { return stacks_; }
 
+    // (from, to) pairs, (from, from) for a retrieval
+    const vector<pair<int, int> > &operations() const { return operations_; }
+
     // attempts to retrieve the next item
     // returns true if successful, false otherwise
     bool retrieveNext();
@@ -100,16 +170,18 @@ public:
     // -1 means no stack
     int lastRelocatedTo() const { return lastRelocatedTo_; }
 
-    // all necessary relocates
+    // all necessary relocates, as (stack, top) pairs by stack
+    // the candidates are kept up to date as stacks change, and their best
+    // safe destinations come from the index of non-full stacks, so these
+    // queries do not scan the bay
     shared_ptr<vector<pair<int, int> > > necessaryRelocates() const;
     
     // all safe 1-relocates
     shared_ptr<vector<tuple<int, int, int> > >
     safeRelocates(shared_ptr<vector<pair<int, int> > > relocates = NULL) const;
     
-    // all safe 2-relocates
-    shared_ptr<vector<tuple<int, int, int> > >
-    safe2Relocates(shared_ptr<vector<pair<int, int> > > relocates = NULL) const;
+    // all safe 2-relocates, one per stack the top of which is moved
+    shared_ptr<vector<tuple<int, int, int> > > safe2Relocates() const;
     
     tuple<int, int, int>
     bestSafeRelocate(shared_ptr<vector<pair<int, int> > > relocates=NULL) const;
@@ -122,13 +194,34 @@ public:
     int smallestAbove(int i) const;
 
     // condense a solution, see Jin et al. (2015)
-    void condenseJin();
+    // stops after the current pass once deadline is reached
+    void condenseJin(const Deadline &deadline = Deadline());
     void condenseJinSub();
     // condense a solution, improved version
-    void condenseTricoire();
+    void condenseTricoire(const Deadline &deadline = Deadline());
     void condenseTricoireSub();
     
 protected:
+    // one condensation pass, see condense.cpp
+    void condensePass(bool tricoire);
+
+    void initEmpty(int W, int n);
+    void setMaxHeight(string maxHeightType);
+
+    // keep the indexes up to date: unindex a stack before it changes, and
+    // index it afterwards
+    void unindex(int s);
+    void index(int s);
+    // key of stack s in nonFull_
+    int stackKey(int s) const { return height_[s] > 0 ? low_[s] : n_ + 1 + s; }
+    // destination of the top of sTo in the best safe 2-relocate through
+    // sTo, and its diff; -1 if there is none
+    int safe2RelocateVia(int sTo, int &diff) const;
+    // stack of a key of nonFull_
+    int keyStack(int key) const {
+        return key <= n_ ? stackForItem_[key] : key - n_ - 1;
+    }
+
     int W_;
     int H_;
     int n_;
@@ -136,6 +229,11 @@ protected:
     vector<vector<int>> stacks_;
     int nRelocations_;
     vector<int> stackForItem_;
+    // tier of every item, the smallest item at or below it, and the
+    // topRun() of its stack if it was on top
+    vector<int> tier_;
+    vector<int> lowBelow_;
+    vector<int> run_;
     unsigned int nRemaining_;
     vector<int> low_;
     vector<int> height_;
@@ -145,6 +243,12 @@ protected:
     vector<pair<int, int>> operations_;
     // stack from where we retrieved an item last
     int lastRelocatedTo_;
+    int lbVersion_;
+    // stacks that are not full, by stackKey()
+    BitIndex nonFull_;
+    // items on top of a stack holding a smaller item, and their stacks
+    BitIndex badTops_;
+    BitIndex badStacks_;
 };
 
 // used to compare how promising is a state compared to another one
@@ -0,0 +1,372 @@
+// condensation of relocation sequences, see Jin et al. (2015)
+// a relocation of item C from s1 to s2 and the next relocation of C, from s2
+// to s3, become a single relocation from s1 to s3 when the operations in
+// between allow it. No other pair can be condensed: an earlier relocation
+// from s2 moves an item above C, and a later one comes after C has moved.
+// C's next move is found by matching the pushes and pops of every stack, and
+// what happens to s3 in between is read from a segment tree over the
+// operations touching s3, so a pass takes O(ops log ops) instead of the
+// pairwise scans of the first implementation. Results are the same.
+
+#include <algorithm>
+#include <climits>
+
+#include "brpstate.h"
+
+namespace {
+
+// operations touching one stack, in the order of the sequence, with the
+// height of the stack after each of them
+class StackTimeline {
+public:
+    // summary of the entries in an interval; removed entries do not count
+    struct Summary {
+        int count = 0;
+        int retrievals = 0;
+        // net change of the height
+        int sum = 0;
+        int minHeight = none;
+        // highest height after a relocation onto the stack
+        int maxPushHeight = -none;
+    };
+
+    // entries are added in the order of their positions, before build()
+    void add(int position, int delta, int height, bool retrieval) {
+        positions_.push_back(position);
+        Summary leaf;
+        leaf.count = 1;
+        leaf.retrievals = retrieval ? 1 : 0;
+        leaf.sum = delta;
+        leaf.minHeight = height;
+        leaf.maxPushHeight = delta > 0 ? height : -none;
+        leaves_.push_back(leaf);
+    }
+
+    void build() {
+        size_ = positions_.size();
+        if ( size_ > 0 ) {
+            nodes_.resize(4 * size_);
+            pending_.assign(4 * size_, 0);
+            build(1, 0, size_ - 1);
+        }
+        leaves_.clear();
+    }
+
+    // entries at positions strictly between from and to
+    Summary query(int from, int to) {
+        int first, last;
+        Summary result;
+        if ( range(from, to, first, last) ) {
+            query(1, 0, size_ - 1, first, last, result);
+        }
+        return result;
+    }
+
+    // add delta to the heights at positions strictly between from and to
+    void addHeight(int from, int to, int delta) {
+        int first, last;
+        if ( range(from, to, first, last) ) {
+            addHeight(1, 0, size_ - 1, first, last, delta);
+        }
+    }
+
+    // the operation at position no longer touches this stack
+    void remove(int position) {
+        auto it = lower_bound(positions_.begin(), positions_.end(), position);
+        if ( it != positions_.end() && *it == position ) {
+            remove(1, 0, size_ - 1, it - positions_.begin());
+        }
+    }
+
+protected:
+    // far from any height, but safe to add to
+    static const int none = INT_MAX / 4;
+
+    // indices of the entries strictly between from and to
+    bool range(int from, int to, int &first, int &last) const {
+        first = upper_bound(positions_.begin(), positions_.end(), from) -
+            positions_.begin();
+        last = lower_bound(positions_.begin(), positions_.end(), to) -
+            positions_.begin() - 1;
+        return first <= last;
+    }
+
+    static void merge(Summary &result, const Summary &other) {
+        result.count += other.count;
+        result.retrievals += other.retrievals;
+        result.sum += other.sum;
+        result.minHeight = min(result.minHeight, other.minHeight);
+        result.maxPushHeight = max(result.maxPushHeight, other.maxPushHeight);
+    }
+
+    void apply(int node, int delta) {
+        nodes_[node].minHeight += delta;
+        nodes_[node].maxPushHeight += delta;
+        pending_[node] += delta;
+    }
+
+    void pushDown(int node) {
+        if ( pending_[node] != 0 ) {
+            apply(2 * node, pending_[node]);
+            apply(2 * node + 1, pending_[node]);
+            pending_[node] = 0;
+        }
+    }
+
+    void pull(int node) {
+        nodes_[node] = nodes_[2 * node];
+        merge(nodes_[node], nodes_[2 * node + 1]);
+    }
+
+    void build(int node, int lo, int hi) {
+        if ( lo == hi ) {
+            nodes_[node] = leaves_[lo];
+            return;
+        }
+        int mid = (lo + hi) / 2;
+        build(2 * node, lo, mid);
+        build(2 * node + 1, mid + 1, hi);
+        pull(node);
+    }
+
+    void query(int node, int lo, int hi, int first, int last,
+               Summary &result) {
+        if ( last < lo || hi < first ) {
+            return;
+        }
+        if ( first <= lo && hi <= last ) {
+            merge(result, nodes_[node]);
+            return;
+        }
+        pushDown(node);
+        int mid = (lo + hi) / 2;
+        query(2 * node, lo, mid, first, last, result);
+        query(2 * node + 1, mid + 1, hi, first, last, result);
+    }
+
+    void addHeight(int node, int lo, int hi, int first, int last,
+                   int delta) {
+        if ( last < lo || hi < first ) {
+            return;
+        }
+        if ( first <= lo && hi <= last ) {
+            apply(node, delta);
+            return;
+        }
+        pushDown(node);
+        int mid = (lo + hi) / 2;
+        addHeight(2 * node, lo, mid, first, last, delta);
+        addHeight(2 * node + 1, mid + 1, hi, first, last, delta);
+        pull(node);
+    }
+
+    void remove(int node, int lo, int hi, int index) {
+        if ( lo == hi ) {
+            nodes_[node] = Summary();
+            return;
+        }
+        pushDown(node);
+        int mid = (lo + hi) / 2;
+        if ( index <= mid ) {
+            remove(2 * node, lo, mid, index);
+        } else {
+            remove(2 * node + 1, mid + 1, hi, index);
+        }
+        pull(node);
+    }
+
+    vector<int> positions_;
+    vector<Summary> leaves_;
+    vector<Summary> nodes_;
+    vector<int> pending_;
+    int size_ = 0;
+};
+
+// number of operations left before a position, as the passes count
+// positions in the condensed sequence
+class Fenwick {
+public:
+    explicit Fenwick(int size) : tree_(size + 1, 0) {
+        for (int i=1; i <= size; i++) {
+            tree_[i] += 1;
+            if ( i + (i & -i) <= size ) {
+                tree_[i + (i & -i)] += tree_[i];
+            }
+        }
+    }
+
+    void remove(int position) {
+        for (int i = position + 1; i < tree_.size(); i += i & -i) {
+            tree_[i] -= 1;
+        }
+    }
+
+    // elements before position
+    int before(int position) const {
+        int result = 0;
+        for (int i = position; i > 0; i -= i & -i) {
+            result += tree_[i];
+        }
+        return result;
+    }
+
+protected:
+    vector<int> tree_;
+};
+
+}
+
+void BRPState::condenseTricoire(const Deadline &deadline) {
+    while(true) {
+        int sizeBefore = nRelocations();
+        condenseTricoireSub();
+        if (sizeBefore == nRelocations() || deadline.reached()) {
+            break;
+        }
+    }
+}
+
+void BRPState::condenseJin(const Deadline &deadline) {
+    while(true) {
+        int sizeBefore = nRelocations();
+        condenseJinSub();
+        if (sizeBefore == nRelocations() || deadline.reached()) {
+            break;
+        }
+    }
+}
+
+void BRPState::condenseTricoireSub() {
+    condensePass(true);
+}
+
+void BRPState::condenseJinSub() {
+    condensePass(false);
+}
+
+// one pass over the sequence, condensing pairs in the same order as the
+// original procedures; the Jin rule needs s3 to be untouched between the two
+// relocations, the Tricoire rule only needs s3 to keep its items and not to
+// be used as a buffer stack there. As in the original procedures:
+// - stack heights are counted from n / W for every stack;
+// - only pairs whose second relocation is among the first nRelocations_
+//   operations are considered.
+void BRPState::condensePass(bool tricoire) {
+    vector<pair<int, int> > &ops = operations_;
+    int nOps = ops.size();
+    vector<StackTimeline> timelines(W_);
+    vector<int> heights(W_, n_ / W_);
+    // position of the next move of the item each relocation moves
+    vector<int> nextMove(nOps, -1);
+    vector<vector<int> > pushes(W_);
+    for (int i=0; i < nOps; i++) {
+        int from = ops[i].first;
+        int to = ops[i].second;
+        heights[from] -= 1;
+        timelines[from].add(i, -1, heights[from], from == to);
+        if ( ! pushes[from].empty() ) {
+            nextMove[pushes[from].back()] = i;
+            pushes[from].pop_back();
+        }
+        if ( from != to ) {
+            heights[to] += 1;
+            timelines[to].add(i, 1, heights[to], false);
+            pushes[to].push_back(i);
+        }
+    }
+    for (auto &timeline: timelines) {
+        timeline.build();
+    }
+    Fenwick remaining(nOps);
+    vector<bool> removed(nOps, false);
+    // heights before operation f
+    heights.assign(W_, n_ / W_);
+    auto isRetrieval = [&](int i) { return ops[i].first == ops[i].second; };
+    auto advance = [&](int &f) {
+        if ( ! removed[f] ) {
+            heights[ops[f].first] -= 1;
+            if ( ! isRetrieval(f) ) {
+                heights[ops[f].second] += 1;
+            }
+        }
+        do {
+            f += 1;
+        } while ( f < nOps && removed[f] );
+    };
+    // position of the firstReloc-th operation left
+    int f = 0;
+    int firstReloc = 0;
+    while ( f < nOps && firstReloc < nRelocations_ - 1 ) {
+        // the Jin pass skips retrievals here, the Tricoire one at the end
+        // of the loop; both amount to the same
+        if ( isRetrieval(f) ) {
+            advance(f);
+            firstReloc += 1;
+            continue;
+        }
+        int s1 = ops[f].first;
+        int s2 = ops[f].second;
+        while ( true ) {
+            int m = nextMove[f];
+            if ( m < 0 || isRetrieval(m) ||
+                 remaining.before(m) >= nRelocations_ ) {
+                break;
+            }
+            int s3 = ops[m].second;
+            auto between = timelines[s3].query(f, m);
+            if ( tricoire ) {
+                // height of s3 after f
+                int base = heights[s3] - (s1 == s3 ? 1 : 0);
+                if ( ( s1 != s3 && heights[s3] == H_ ) ||
+                     between.retrievals > 0 ||
+                     between.minHeight < base ||
+                     2 * between.maxPushHeight >= H_ + base ||
+                     between.sum != 0 ) {
+                    break;
+                }
+            } else if ( between.count > 0 ) {
+                break;
+            }
+            // C goes to s3 at f, so s2 has one item less and s3 one more
+            // until m
+            timelines[s2].addHeight(f, m, -1);
+            timelines[s3].addHeight(f, m, 1);
+            timelines[s2].remove(m);
+            timelines[s3].remove(m);
+            removed[m] = true;
+            remaining.remove(m);
+            nRelocations_ -= 1;
+            ops[f].second = s3;
+            nextMove[f] = nextMove[m];
+            s2 = s3;
+            // moving back and forth
+            if ( s1 == s3 ) {
+                removed[f] = true;
+                remaining.remove(f);
+                nRelocations_ -= 1;
+                advance(f);
+                while ( f < nOps && isRetrieval(f) ) {
+                    advance(f);
+                    firstReloc += 1;
+                }
+                if ( f == nOps ) {
+                    break;
+                }
+                s1 = ops[f].first;
+                s2 = ops[f].second;
+            }
+        }
+        if ( f == nOps ) {
+            break;
+        }
+        advance(f);
+        firstReloc += 1;
+    }
+    int kept = 0;
+    for (int i=0; i < nOps; i++) {
+        if ( ! removed[i] ) {
+            ops[kept++] = ops[i];
+        }
+    }
+    ops.resize(kept);
+}
@@ -0,0 +1,94 @@
+#include <atomic>
+#include <mutex>
+#include <iomanip>
+
+#include "counters.h"
+
+thread_local long long Counters::local[Counters::nCounters];
+
+long long Counters::merged_[Counters::nCounters];
+
+// only taken when a thread is done, never while counting
+static mutex mergeMutex;
+
+static bool mergedWithMax(int id) {
+    return id == Counters::peakOpen;
+}
+
+void Counters::mergeThread() {
+    lock_guard<mutex> lock(mergeMutex);
+    for (int i=0; i < nCounters; i++) {
+        if ( mergedWithMax(i) ) {
+            merged_[i] = max(merged_[i], local[i]);
+        } else {
+            merged_[i] += local[i];
+        }
+        local[i] = 0;
+    }
+}
+
+long long Counters::total(Id id) {
+    lock_guard<mutex> lock(mergeMutex);
+    if ( mergedWithMax(id) ) {
+        return max(merged_[id], local[id]);
+    } else {
+        return merged_[id] + local[id];
+    }
+}
+
+void Counters::reset() {
+    lock_guard<mutex> lock(mergeMutex);
+    for (int i=0; i < nCounters; i++) {
+        merged_[i] = 0;
+        local[i] = 0;
+    }
+}
+
+string Counters::name(int id) {
+    switch (id) {
+    case nodes: return "nodes";
+    case prunedByBound: return "pruned_by_bound";
+    case prunedAtBranching: return "pruned_at_branching";
+    case prunedDominated: return "pruned_dominated";
+    case prunedByOrder: return "pruned_by_order";
+    case prunedTransitive: return "pruned_transitive";
+    case prunedReturn: return "pruned_return";
+    case lb1: return "lb1_evaluations";
+    case lb2: return "lb2_evaluations";
+    case lb3: return "lb3_evaluations";
+    case heuristicRollouts: return "heuristic_rollouts";
+    case dives: return "dives";
+    case diveImprovements: return "dive_improvements";
+    case diveSavings: return "dive_relocations_saved";
+    case diveMicroseconds: return "dive_microseconds";
+    case ttProbes: return "tt_probes";
+    case relocationsUndone: return "relocations_undone";
+    case peakOpen: return "peak_open_nodes";
+    default:
+        if ( id == nCounters - 1 ) {
+            return "lb_gap_" + to_string(id - lbGap) + "_or_more";
+        } else {
+            return "lb_gap_" + to_string(id - lbGap);
+        }
+    }
+}
+
+void Counters::print(ostream &os, string format) {
+#ifdef BRP_NO_COUNTERS
+    os << "(counters compiled out)" << endl;
+#else
+    if ( format == "json" ) {
+        os << "{";
+        for (int i=0; i < nCounters; i++) {
+            os << (i > 0 ? ", " : "") << "\"" << name(i) << "\": "
+               << total((Id) i);
+        }
+        os << "}" << endl;
+    } else {
+        for (int i=0; i < nCounters; i++) {
+            os << left << setw(24) << setfill(' ') << name(i)
+               << right << setw(16) << total((Id) i) << endl;
+        }
+    }
+#endif
+}
@@ -0,0 +1,90 @@
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+// search instrumentation
+// each thread increments its own counters, without any synchronisation;
+// worker threads merge them into the process-wide totals when they are done.
+// Compiling with -DBRP_NO_COUNTERS removes all of it.
+
+#include <string>
+#include <iostream>
+
+using namespace std;
+
+class Counters {
+public:
+    enum Id {
+        nodes,
+        // prunes by reason
+        prunedByBound,      // node with depth + LB >= UB
+        prunedAtBranching,  // branch not generated, its bound reaches UB
+        prunedDominated,    // state dominated by another one
+        // relocations skipped by the dominance rules, see dominance.h
+        prunedByOrder,
+        prunedTransitive,
+        prunedReturn,
+        // LB evaluations by kind
+        lb1,
+        lb2,
+        lb3,
+        // calls to a heuristic to evaluate a node
+        heuristicRollouts,
+        // heuristic dives of DFBB, see dfbb.h
+        dives,
+        diveImprovements,   // dives improving the incumbent
+        diveSavings,        // relocations saved by these improvements
+        diveMicroseconds,   // time spent diving
+        // look-ups in tables of known states
+        ttProbes,
+        relocationsUndone,
+        // largest number of open nodes, the depth of the path for DFBB
+        // (merged with max, not sum)
+        peakOpen,
+        // LB3 - LB1 gaps seen by LBcomp(), the last bucket has all larger gaps
+        lbGap,
+        nCounters = lbGap + 8
+    };
+
+    static const int gapBuckets = nCounters - lbGap;
+
+    // counters of the calling thread
+    static thread_local long long local[nCounters];
+
+    // add the counters of the calling thread to the totals and reset them
+    // to be called by worker threads before they finish
+    static void mergeThread();
+
+    // totals, including the calling thread
+    static long long total(Id id);
+
+    // reset totals and counters of the calling thread
+    static void reset();
+
+    // format is table or json
+    static void print(ostream &os, string format);
+
+    static string name(int id);
+
+protected:
+    static long long merged_[nCounters];
+};
+
+#ifdef BRP_NO_COUNTERS
+#define COUNT(id)
+#define COUNT_N(id, n)
+#define COUNT_AT(id, offset)
+#define COUNT_MAX(id, value)
+#else
+#define COUNT(id) (Counters::local[Counters::id] += 1)
+#define COUNT_N(id, n) (Counters::local[Counters::id] += (n))
+// for counters spanning several slots, such as lbGap
+#define COUNT_AT(id, offset) (Counters::local[Counters::id + (offset)] += 1)
+#define COUNT_MAX(id, value)                                            \
+    do {                                                                \
+        if ( (long long) (value) > Counters::local[Counters::id] ) {   \
+            Counters::local[Counters::id] = (value);                    \
+        }                                                               \
+    } while (0)
+#endif
+
+#endif
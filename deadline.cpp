@@ -0,0 +1,62 @@
+#include "deadline.h"
+
+const unsigned int Deadline::checkPeriod = 256;
+
+Deadline::Deadline(double timeLimit) {
+    unlimited_ = (timeLimit <= 0);
+    end_ = chrono::steady_clock::now() +
+        chrono::duration_cast<chrono::steady_clock::duration>(
+            chrono::duration<double>(timeLimit) );
+    flag_ = make_shared<Flag>();
+    flag_->cancelled.store(false);
+    countdown_ = checkPeriod;
+    expired_ = false;
+}
+
+bool Deadline::cancelled() const {
+    for (Flag *f = flag_.get(); f != NULL; f = f->parent.get()) {
+        if ( f->cancelled.load(memory_order_relaxed) ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Deadline::reached() const {
+    return expired_ || cancelled() ||
+        ( ! unlimited_ && chrono::steady_clock::now() >= end_ );
+}
+
+bool Deadline::poll() {
+    if ( expired_ ) {
+        return true;
+    }
+    if ( --countdown_ > 0 ) {
+        return false;
+    }
+    countdown_ = checkPeriod;
+    expired_ = reached();
+    return expired_;
+}
+
+Deadline Deadline::capped(double timeLimit) const {
+    Deadline result(*this);
+    if ( timeLimit > 0 ) {
+        auto end = chrono::steady_clock::now() +
+            chrono::duration_cast<chrono::steady_clock::duration>(
+                chrono::duration<double>(timeLimit) );
+        if ( unlimited_ || end < end_ ) {
+            result.end_ = end;
+            result.unlimited_ = false;
+        }
+    }
+    return result;
+}
+
+Deadline Deadline::child() const {
+    Deadline result(*this);
+    result.flag_ = make_shared<Flag>();
+    result.flag_->cancelled.store(false);
+    result.flag_->parent = flag_;
+    return result;
+}
@@ -0,0 +1,58 @@
+#ifndef DEADLINE_H
+#define DEADLINE_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+using namespace std;
+
+// wall-clock deadline and cancellation token passed to BRPPolicy::solve()
+// copies share the same cancellation flag, so cancelling one copy cancels
+// them all. Policies return the best solution found so far once it is
+// reached.
+class Deadline {
+public:
+    // expires timeLimit seconds from now; 0 means no time limit
+    explicit Deadline(double timeLimit = 0);
+
+    // cancel this deadline, its copies and the deadlines derived from it
+    void cancel() const { flag_->cancelled.store(true); }
+
+    // true if cancelled or expired
+    bool reached() const;
+
+    // same as reached(), but the clock is only read every checkPeriod calls;
+    // meant to be called at every node of a search, on a copy owned by the
+    // calling thread
+    bool poll();
+
+    // earliest of this deadline and timeLimit seconds from now (0 means no
+    // additional limit); shares the cancellation flag of this deadline
+    Deadline capped(double timeLimit) const;
+
+    // same deadline with its own cancellation flag, also cancelled when this
+    // one is
+    Deadline child() const;
+
+protected:
+    // cancellation flag, chained to the flag of the deadline it derives from
+    struct Flag {
+        atomic<bool> cancelled;
+        shared_ptr<Flag> parent;
+    };
+    
+    chrono::steady_clock::time_point end_;
+    bool unlimited_;
+    shared_ptr<Flag> flag_;
+    // number of calls to poll() before the clock is read again
+    unsigned int countdown_;
+    // set once the deadline has been found expired or cancelled
+    bool expired_;
+
+    static const unsigned int checkPeriod;
+
+    bool cancelled() const;
+};
+
+#endif
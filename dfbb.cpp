@@ -1,34 +1,79 @@
 #include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <cstdio>
+#include <limits>
 
 #include "dfbb.h"
+#include "counters.h"
 
-extern unique_ptr<BRPPolicy> ubSolver;
-extern bool verbose;
+// classes of the low of a destination stack: empty, then how far above
+// the relocated item, then how far below, on a log scale
+static const int nLowClasses = 17;
+
+// record of relocating item to a stack with that low, for the history
+static int moveRecord(int item, int low, int n) {
+    int lowClass = 0;
+    if ( low <= n ) {
+        int gap = low > item ? low - item : item - low;
+        lowClass = min(31 - __builtin_clz(gap), 7) + (low > item ? 1 : 9);
+    }
+    return item * nLowClasses + lowClass;
+}
 
 DFBB::DFBB(unsigned int UB, unsigned int timeLimit) {
     UB_ = UB;
     timeLimit_ = timeLimit;
 }
     
-shared_ptr<BRPState> DFBB::solve(const BRPState &initialState) const {
-    clock_t startTicks = 0;
-    if (timeLimit_ > 0) {
-        startTicks = clock();
-    }
-    // 
-    BRPState currentState(initialState);
-    clock_t before = clock();
-    shared_ptr<BRPState> bestFound = ubSolver->solve(initialState);
-    cout << "Calculated UB in " << ((double)clock() - before) / CLOCKS_PER_SEC
+shared_ptr<BRPState> DFBB::solve(const BRPState &initialState,
+                                 const Deadline &callerDeadline) const {
+    Deadline deadline = callerDeadline.capped(timeLimit_);
+    auto before = chrono::steady_clock::now();
+    COUNT(heuristicRollouts);
+    shared_ptr<BRPState> bestFound = restrictedIncumbent(
+        initialState, context().ubSolver->solve(initialState, deadline));
+    log() << "Calculated UB in "
+         << chrono::duration<double>(chrono::steady_clock::now() - before)
+        .count()
          << " seconds" << endl;
+    return search(initialState, bestFound, deadline);
+}
+
+shared_ptr<BRPState> DFBB::improve(const BRPState &initialState,
+                                   shared_ptr<BRPState> incumbent,
+                                   const Deadline &callerDeadline) const {
+    Deadline deadline = callerDeadline.capped(timeLimit_);
+    return search(initialState, restrictedIncumbent(initialState, incumbent),
+                  deadline);
+}
+
+shared_ptr<BRPState> DFBB::search(const BRPState &initialState,
+                                  shared_ptr<BRPState> bestFound,
+                                  Deadline &deadline) const {
+    BRPState currentState(initialState);
     unsigned int bestObj = min(UB_, bestFound->nRelocations());
+    DFBBPath path;
+    if ( checkpoint_ != "" &&
+         readCheckpoint(initialState, currentState, path, bestFound,
+                        bestObj) ) {
+        log() << "Resuming from " << checkpoint_ << " at depth "
+              << path.depth << " with UB = " << bestObj << endl;
+    }
     //
-    cout << "Starting builtin depth-first branch-and-bound with LB = "
-         << currentState.LB()
+    log() << "Starting builtin depth-first branch-and-bound with LB = "
+         << initialState.LB()
          << " and UB = " << bestObj << endl;
-    bool finished = solveSub(currentState, -1, bestFound, bestObj, startTicks);
+    bool finished = explore(currentState, -1, path, bestFound, bestObj,
+                            deadline);
     if (! finished) {
-        cout << "DFBB: Time limit reached!" << endl;
+        log() << "DFBB: Time limit reached!" << endl;
+        if ( checkpoint_ != "" ) {
+            writeCheckpoint(initialState, path, *bestFound, bestObj);
+            log() << "Search saved to " << checkpoint_ << endl;
+        }
+    } else if ( checkpoint_ != "" ) {
+        remove(checkpoint_.c_str());
     }
     return bestFound;
 }
@@ -40,19 +85,82 @@ bool DFBB::solveSub(BRPState &currentState,
                     unsigned int lastRelocatedTo,
                     shared_ptr<BRPState> &bestFound,
                     unsigned int &bestObj,
-                    const clock_t &startTicks) const {
-    // cout << "\t from subroutine, timeLimit_ = " << timeLimit_
-    //      << endl;
+                    Deadline &deadline) const {
+    DFBBPath path;
+    return explore(currentState, lastRelocatedTo, path, bestFound, bestObj,
+                   deadline);
+}
+
+bool DFBB::explore(BRPState &currentState,
+                   unsigned int lastRelocatedTo,
+                   DFBBPath &path,
+                   shared_ptr<BRPState> &bestFound,
+                   unsigned int &bestObj,
+                   Deadline &deadline) const {
+    if ( path.depth == 0 ) {
+        path.firstOp = currentState.operations().size();
+    }
+    if ( path.history.empty() ) {
+        path.history.assign((currentState.n() + 1) * nLowClasses, 0);
+    }
+    if ( path.depth == 0 &&
+         ! enter(currentState, lastRelocatedTo, path, bestFound, bestObj,
+                 deadline) ) {
+        return false;
+    }
+    while ( path.depth > 0 ) {
+        DFBBFrame &frame = path.top();
+        if ( frame.next < frame.branches.size() ) {
+            // branch and evaluate the subtree
+            DFBBBranch branch = frame.branches[frame.next++];
+            currentState.relocate(branch.from, branch.to);
+            if ( ! enter(currentState, branch.to, path, bestFound,
+                         bestObj, deadline) ) {
+                // the branch is explored again when the search resumes
+                path.top().next -= 1;
+                currentState.undoLastMove();
+                return false;
+            }
+        } else {
+            // the subtree is done: cancel retrievals, then the branching
+            // decision leading to it
+            while (frame.nRetrievals > 0) {
+                currentState.undoLastMove();
+                frame.nRetrievals -= 1;
+            }
+            path.depth -= 1;
+            if ( path.depth > 0 ) {
+                currentState.undoLastMove();
+            }
+        }
+    }
+    return true;
+}
+
+bool DFBB::enter(BRPState &currentState,
+                 unsigned int lastRelocatedTo,
+                 DFBBPath &path,
+                 shared_ptr<BRPState> &bestFound,
+                 unsigned int &bestObj,
+                 Deadline &deadline) const {
     // step 0: do we still have time?
-    if ( timeLimit_ > 0 &&
-         ((double) clock() - startTicks) / CLOCKS_PER_SEC > timeLimit_){
+    if ( deadline.poll() ) {
         return false;
     }
+    COUNT(nodes);
+    if ( path.depth == path.frames.size() ) {
+        path.frames.push_back(DFBBFrame());
+    }
+    DFBBFrame &frame = path.frames[path.depth++];
+    // the nodes on the path are the open ones
+    COUNT_MAX(peakOpen, path.depth);
+    frame.nRetrievals = 0;
+    frame.branches.clear();
+    frame.next = 0;
     
     // step 1: perform all possible retrievals
-    int nRetrievals = 0;
     while (currentState.retrieveNext()) {
-        nRetrievals += 1;
+        frame.nRetrievals += 1;
         lastRelocatedTo = -1;
     }
     // are we done?
@@ -61,129 +169,469 @@ bool DFBB::solveSub(BRPState &currentState,
         if (currentState.nRelocations() < bestObj) {
             bestObj = currentState.nRelocations();
             bestFound = make_shared<BRPState>(currentState);
+            reward(path);
         }
-    } else if (currentState.nRelocations() + currentState.LB() >= bestObj) {
-        // if ( currentState.nRelocations() + currentState.LB2() < bestObj) {
-        //     cout << currentState << endl;
-        //     cout << "LB1 = " << currentState.LB1() << endl;
-        //     cout << "LB2 = " << currentState.LB2() << endl;
-        //     cout << "LB3 = " << currentState.LB3() << endl;
-        // }        
-        ;
-    } else { // step 2: branch and evaluate subtrees
-
-        // // special case: do we have depth+LB = UB - 1?
-        // // if yes: compute UB at this node
-        // if ( currentState.nRelocations() + currentState.LB() == bestObj - 1 ) {
-        //     shared_ptr<BRPState> ns = ubSolver->solve(currentState);
-        //     if ( ns->nRelocations() < bestObj ) {
-        //         cout << "tralala" << endl;
-        //         bestObj = ns->nRelocations();
-        //         bestFound = ns;
-        //     }
-        // }
-        
-        // each possible relocation is a branch
-        // a branch is a <LB, from, to> tuple
-        vector<tuple<unsigned int, unsigned int, int> > branches;
-        int currentLB = currentState.LB1();
-        for (unsigned int sFrom=0; sFrom < currentState.W(); sFrom++) {
-            // only relocate from stacks with at least one item and which
-            // are not the last stack we relocated to
-            if ( sFrom != lastRelocatedTo &&
-                 currentState.height(sFrom) > 0 ) {
-                // item being relocated
-                unsigned int item = currentState.top(sFrom);
-                // look-ahead part 1: difference on LB induced by relocating
-                // item from sFrom
-                int fromDiff = 0;
-                if (currentState.low(sFrom) < item) {
-                    fromDiff = -1;
-                }
-                bool relocatedToEmpty = false;
-                // now try every destination stack
-                for (unsigned int sTo=0; sTo < currentState.W(); sTo++) {
-                    if (sTo != sFrom &&  // do not relocate to same stack
-                        currentState.height(sTo) < currentState.H()) {
-                        // only relocate to an empty stack once to
-                        // break symmetry
-                        if (relocatedToEmpty &&
-                            currentState.height(sTo) == 0) {
-                            continue;
-                        }
-                        // look-ahead part 2: difference on LB induced by
-                        // relocating item to sTo
-                        int toDiff = 0;
-                        if (currentState.low(sTo) < item) {
-                            toDiff = 1;
-                        }
-                        int newBound = currentState.nRelocations() + 1 +
-                            currentLB + fromDiff + toDiff;
-                        // would that move be promising?
-                        if (newBound < bestObj) {
-                            branches.push_back(make_tuple(newBound,
-                                                          sFrom, sTo));
+    } else if (currentState.nRelocations() + nodeLB(currentState) >=
+               bestObj) {
+        COUNT(prunedByBound);
+    } else {
+        // step 2: dive from the node, which may lower bestObj to its bound
+        if ( context().diveSolver ) {
+            unsigned int bound = currentState.nRelocations() +
+                nodeLB(currentState);
+            dive(currentState, bound, path, bestFound, bestObj, deadline);
+            if ( bound >= bestObj ) {
+                COUNT(prunedByBound);
+                return true;
+            }
+        }
+        // step 3: generate the branches, explored by explore()
+        prepareDominance(currentState, path, path.depth - 1);
+        branch(currentState, lastRelocatedTo, bestObj, path, frame);
+    }
+    return true;
+}
+
+void DFBB::dive(const BRPState &currentState,
+                unsigned int bound,
+                DFBBPath &path,
+                shared_ptr<BRPState> &bestFound,
+                unsigned int &bestObj,
+                const Deadline &deadline) const {
+    int param = context().diveParam;
+    switch ( context().diveSchedule ) {
+    case diveByDepth:
+        if ( (int) path.depth - 1 > param ) {
+            return;
+        }
+        break;
+    case diveByGap:
+        if ( (int) (bestObj - bound) < param ) {
+            return;
+        }
+        break;
+    case diveAdaptive:
+        if ( path.nodesToDive > 0 ) {
+            path.nodesToDive -= 1;
+            return;
+        }
+        break;
+    }
+    COUNT(dives);
+    auto before = chrono::steady_clock::now();
+    shared_ptr<BRPState> solution = restrictedIncumbent(
+        currentState, context().diveSolver->solve(currentState, deadline));
+    COUNT_N(diveMicroseconds, chrono::duration_cast<chrono::microseconds>(
+                chrono::steady_clock::now() - before).count());
+    path.nDives += 1;
+    if ( solution->nRelocations() < bestObj ) {
+        COUNT(diveImprovements);
+        COUNT_N(diveSavings, bestObj - solution->nRelocations());
+        bestObj = solution->nRelocations();
+        bestFound = solution;
+        // the branches leading here got the search closer to it
+        reward(path);
+        path.nImprovingDives += 1;
+    }
+    path.nodesToDive = param * (path.nDives + 1) / (path.nImprovingDives + 1);
+}
+
+bool parseDiveSchedule(string spec, DiveSchedule &schedule, int &param) {
+    size_t colon = spec.find(':');
+    string name = spec.substr(0, colon);
+    param = 100;
+    if ( colon != string::npos ) {
+        string number = spec.substr(colon + 1);
+        if ( number == "" || number.size() > 9 ||
+             number.find_first_not_of("0123456789") != string::npos ) {
+            return false;
+        }
+        param = stoi(number);
+    } else if ( name != "adaptive" ) {
+        return false;
+    }
+    if ( name == "depth" ) {
+        schedule = diveByDepth;
+    } else if ( name == "gap" ) {
+        schedule = diveByGap;
+    } else if ( name == "adaptive" ) {
+        schedule = diveAdaptive;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void DFBB::branch(const BRPState &currentState,
+                  unsigned int lastRelocatedTo,
+                  unsigned int bestObj,
+                  const DFBBPath &path,
+                  DFBBFrame &frame) const {
+    // each possible relocation is a branch; in the restricted BRP, only
+    // those of the item above the next one
+    int currentLB = currentState.LB1();
+    unsigned int firstFrom = 0;
+    unsigned int endFrom = currentState.W();
+    if ( context().restricted ) {
+        firstFrom = currentState.stackForItem(currentState.next());
+        endFrom = firstFrom + 1;
+    }
+    for (unsigned int sFrom=firstFrom; sFrom < endFrom; sFrom++) {
+        // only relocate from stacks with at least one item and which
+        // are not the last stack we relocated to
+        if ( sFrom != lastRelocatedTo &&
+             currentState.height(sFrom) > 0 ) {
+            // item being relocated
+            unsigned int item = currentState.top(sFrom);
+            // look-ahead part 1: difference on LB induced by relocating
+            // item from sFrom
+            int fromDiff = 0;
+            if (currentState.low(sFrom) < item) {
+                fromDiff = -1;
+            }
+            bool relocatedToEmpty = false;
+            // now try every destination stack
+            for (unsigned int sTo=0; sTo < currentState.W(); sTo++) {
+                if (sTo != sFrom &&  // do not relocate to same stack
+                    currentState.height(sTo) < currentState.H()) {
+                    // only relocate to an empty stack once to
+                    // break symmetry
+                    if (relocatedToEmpty &&
+                        currentState.height(sTo) == 0) {
+                        continue;
+                    }
+                    // look-ahead part 2: difference on LB induced by
+                    // relocating item to sTo
+                    int toDiff = 0;
+                    if (currentState.low(sTo) < item) {
+                        toDiff = 1;
+                    }
+                    int newBound = currentState.nRelocations() + 1 +
+                        currentLB + fromDiff + toDiff;
+                    // would that move be promising?
+                    if (newBound < bestObj) {
+                        if (! frame.dominance.dominated(currentState, sFrom,
+                                                        sTo)) {
+                            int record = moveRecord(item,
+                                                    currentState.low(sTo),
+                                                    currentState.n());
+                            int rank = record == frame.killer ?
+                                numeric_limits<int>::min() :
+                                -path.history[record];
+                            frame.branches.push_back(
+                                DFBBBranch{(unsigned int) newBound, rank,
+                                        sFrom, (int) sTo, record});
                         }
+                    } else {
+                        COUNT(prunedAtBranching);
                     }
                 }
             }
         }
-        // now that all branches are computed, sort them from most to least
-        // promising and try them all
-        sort(branches.begin(), branches.end());
-        bool keepGoing = true;
-        for (auto branch: branches) {
-            // 2.1: branch
-            currentState.relocate(get<1>(branch), get<2>(branch));
-            // 2.2: evaluate subtree
-            keepGoing = solveSub(currentState,
-                                 get<2>(branch),
-                                 bestFound,
-                                 bestObj,
-                                 startTicks);
-            // 2.3: cancel branching decision
-            currentState.undoLastMove();
-            // 2.4: it time limit has been reached, stop everything
-            if (! keepGoing) {
-                return false;
-            }
+    }
+    // now that all branches are computed, sort them from most to least
+    // promising
+    sort(frame.branches.begin(), frame.branches.end());
+}
+
+void DFBB::reward(DFBBPath &path) const {
+    // frames[d] branched to frames[d + 1]; the earlier the branch, the
+    // larger the subtree it chose
+    for (size_t d=0; d + 1 < path.depth; d++) {
+        DFBBFrame &frame = path.frames[d];
+        int record = frame.branches[frame.next - 1].record;
+        path.history[record] += path.depth - 1 - d;
+        frame.killer = record;
+    }
+}
+
+void DFBB::prepareDominance(const BRPState &currentState, DFBBPath &path,
+                            size_t d) const {
+    DFBBFrame &frame = path.frames[d];
+    if ( d == 0 ) {
+        frame.dominance.reset(currentState, context().dominanceRules,
+                              path.firstOp);
+    } else {
+        // the relocation leading to the node, then its retrievals
+        frame.dominance.follow(path.frames[d - 1].dominance, currentState,
+                               1 + frame.nRetrievals);
+    }
+}
+
+// checkpoint file, all numbers in text:
+//   DFBB-checkpoint 3
+//   W H, then every stack of the initial state: height, items
+//   bestObj, number of operations of the incumbent after those of the
+//   initial state, the operations as from to pairs
+//   number of counters, the counters
+//   number of records with a history weight, the records as record weight
+//   number of frames, the killer of every frame, those beyond depth too
+//   nodesToDive nDives nImprovingDives
+//   depth, then every frame: nRetrievals next number of branches, the
+//   branches as LB from to
+static const int checkpointVersion = 3;
+
+void DFBB::writeCheckpoint(const BRPState &initialState,
+                           const DFBBPath &path,
+                           const BRPState &bestFound,
+                           unsigned int bestObj) const {
+    ofstream ofs(checkpoint_);
+    if ( ! ofs ) {
+        cerr << "cannot write checkpoint " << checkpoint_ << endl;
+        exit(12);
+    }
+    ofs << "DFBB-checkpoint " << checkpointVersion << '\n';
+    ofs << initialState.W() << ' ' << initialState.H() << '\n';
+    for (auto &stack: initialState.stacks()) {
+        ofs << stack.size();
+        for (auto item: stack) {
+            ofs << ' ' << item;
+        }
+        ofs << '\n';
+    }
+    auto &ops = bestFound.operations();
+    int first = initialState.operations().size();
+    ofs << bestObj << ' ' << ops.size() - first;
+    for (int i=first; i < ops.size(); i++) {
+        ofs << ' ' << ops[i].first << ' ' << ops[i].second;
+    }
+    ofs << '\n' << Counters::nCounters;
+    for (int i=0; i < Counters::nCounters; i++) {
+        ofs << ' ' << Counters::local[i];
+    }
+    int nWeighted = path.history.size() -
+        count(path.history.begin(), path.history.end(), 0);
+    ofs << '\n' << nWeighted;
+    for (int record=0; record < path.history.size(); record++) {
+        if ( path.history[record] != 0 ) {
+            ofs << ' ' << record << ' ' << path.history[record];
         }
     }
-    // step 3: cancel retrievals
-    while (nRetrievals > 0) {
-        currentState.undoLastMove();
-        nRetrievals -= 1;
+    ofs << '\n' << path.frames.size();
+    for (auto &frame: path.frames) {
+        ofs << ' ' << frame.killer;
     }
+    ofs << '\n' << path.nodesToDive << ' ' << path.nDives << ' '
+        << path.nImprovingDives;
+    ofs << '\n' << path.depth << '\n';
+    for (int d=0; d < path.depth; d++) {
+        auto &frame = path.frames[d];
+        ofs << frame.nRetrievals << ' ' << frame.next << ' '
+            << frame.branches.size();
+        for (auto &branch: frame.branches) {
+            ofs << ' ' << branch.bound << ' ' << branch.from << ' '
+                << branch.to;
+        }
+        ofs << '\n';
+    }
+    if ( ! ofs ) {
+        cerr << "cannot write checkpoint " << checkpoint_ << endl;
+        exit(12);
+    }
+}
+
+// false if the operation cannot be performed
+static bool replay(BRPState &state, int from, int to) {
+    if ( from < 0 || from >= state.W() || to < 0 || to >= state.W() ||
+         state.height(from) == 0 ) {
+        return false;
+    }
+    if ( from == to ) {
+        return state.top(from) == state.next() && state.retrieveNext();
+    }
+    if ( state.height(to) >= state.H() ) {
+        return false;
+    }
+    state.relocate(from, to);
     return true;
 }
 
-shared_ptr<BRPState> DFBBLoop::solve(const BRPState &initialState) const {
-    clock_t startTicks = 0;
-    if (timeLimit_ > 0) {
-        startTicks = clock();
+bool DFBB::readCheckpoint(const BRPState &initialState,
+                          BRPState &currentState,
+                          DFBBPath &path,
+                          shared_ptr<BRPState> &bestFound,
+                          unsigned int &bestObj) const {
+    ifstream ifs(checkpoint_);
+    if ( ! ifs ) {
+        return false;
+    }
+    auto invalid = [&](string what) {
+        cerr << "invalid checkpoint " << checkpoint_ << ": " << what << endl;
+        exit(12);
+    };
+    string magic;
+    int version, W, H;
+    ifs >> magic >> version >> W >> H;
+    if ( ! ifs || magic != "DFBB-checkpoint" ||
+         version != checkpointVersion ) {
+        invalid("not a DFBB checkpoint");
+    }
+    if ( W != initialState.W() || H != initialState.H() ) {
+        invalid("not a search of this instance");
+    }
+    for (auto &stack: initialState.stacks()) {
+        size_t height;
+        ifs >> height;
+        if ( ! ifs || height != stack.size() ) {
+            invalid("not a search of this instance");
+        }
+        for (auto item: stack) {
+            int other;
+            ifs >> other;
+            if ( ! ifs || other != item ) {
+                invalid("not a search of this instance");
+            }
+        }
+    }
+    unsigned int savedObj;
+    int nOps;
+    ifs >> savedObj >> nOps;
+    if ( ! ifs || nOps < 0 ) {
+        invalid("incumbent");
+    }
+    BRPState incumbent(initialState);
+    for (int i=0; i < nOps; i++) {
+        int from, to;
+        ifs >> from >> to;
+        if ( ! ifs || ! replay(incumbent, from, to) ) {
+            invalid("incumbent");
+        }
+    }
+    if ( ! incumbent.empty() ) {
+        invalid("incumbent");
+    }
+    int nCounters;
+    ifs >> nCounters;
+    if ( ! ifs || nCounters != Counters::nCounters ) {
+        invalid("counters");
+    }
+    long long counters[Counters::nCounters];
+    for (int i=0; i < nCounters; i++) {
+        ifs >> counters[i];
+    }
+    if ( ! ifs ) {
+        invalid("counters");
     }
+    DFBBPath saved;
+    saved.history.assign((initialState.n() + 1) * nLowClasses, 0);
+    int nWeighted;
+    ifs >> nWeighted;
+    for (int i=0; i < nWeighted && ifs; i++) {
+        int record;
+        ifs >> record;
+        if ( record < 0 || record >= saved.history.size() ) {
+            invalid("history");
+        }
+        ifs >> saved.history[record];
+    }
+    size_t nFrames;
+    ifs >> nFrames;
+    if ( ! ifs ) {
+        invalid("history");
+    }
+    saved.frames.resize(nFrames);
+    for (auto &frame: saved.frames) {
+        ifs >> frame.killer;
+        if ( frame.killer < -1 ||
+             frame.killer >= (int) saved.history.size() ) {
+            invalid("history");
+        }
+    }
+    ifs >> saved.nodesToDive >> saved.nDives >> saved.nImprovingDives;
+    size_t depth;
+    ifs >> depth;
+    if ( ! ifs ) {
+        invalid("history");
+    }
+    BRPState state(initialState);
+    saved.frames.resize(max(depth, nFrames));
+    saved.depth = depth;
+    saved.firstOp = initialState.operations().size();
+    for (int d=0; d < depth; d++) {
+        auto &frame = saved.frames[d];
+        size_t nBranches;
+        ifs >> frame.nRetrievals >> frame.next >> nBranches;
+        if ( ! ifs || frame.next > nBranches ||
+             ( d < depth - 1 && frame.next == 0 ) ) {
+            invalid("path");
+        }
+        for (int r=0; r < frame.nRetrievals; r++) {
+            if ( ! state.retrieveNext() ) {
+                invalid("path");
+            }
+        }
+        prepareDominance(state, saved, d);
+        for (int b=0; b < nBranches; b++) {
+            unsigned int bound, from;
+            int to;
+            ifs >> bound >> from >> to;
+            if ( ! ifs || from >= W || to < 0 || to >= W ||
+                 state.height(from) == 0 ) {
+                invalid("path");
+            }
+            // the order of the branches is that of the file
+            frame.branches.push_back(
+                DFBBBranch{bound, 0, from, to,
+                        moveRecord(state.top(from), state.low(to),
+                                   state.n())});
+        }
+        // relocation leading to the next frame
+        if ( d < depth - 1 ) {
+            auto &branch = frame.branches[frame.next - 1];
+            if ( branch.from == branch.to ||
+                 ! replay(state, branch.from, branch.to) ) {
+                invalid("path");
+            }
+        }
+    }
+    currentState = state;
+    path = saved;
+    if ( savedObj < bestObj ) {
+        bestObj = savedObj;
+        bestFound = make_shared<BRPState>(incumbent);
+    }
+    for (int i=0; i < Counters::nCounters; i++) {
+        if ( i == Counters::peakOpen ) {
+            Counters::local[i] = max(Counters::local[i], counters[i]);
+        } else {
+            Counters::local[i] += counters[i];
+        }
+    }
+    return true;
+}
+
+shared_ptr<BRPState> DFBBLoop::solve(const BRPState &initialState,
+                                     const Deadline &callerDeadline) const {
+    Deadline deadline = callerDeadline.capped(timeLimit_);
 
-    if ( verbose ) {
-        cout << "Starting DFBB-Loop with time limit = " << timeLimit_ << endl;
+    if ( context().verbose ) {
+        log() << "Starting DFBB-Loop with time limit = " << timeLimit_ << endl;
     }
     
-    //
+    COUNT(heuristicRollouts);
+    shared_ptr<BRPState> bestFound = restrictedIncumbent(
+        initialState, context().ubSolver->solve(initialState, deadline));
+    return search(initialState, bestFound, deadline);
+}
+
+shared_ptr<BRPState> DFBBLoop::search(const BRPState &initialState,
+                                      shared_ptr<BRPState> bestFound,
+                                      Deadline &deadline) const {
     BRPState currentState(initialState);
-    shared_ptr<BRPState> bestFound = ubSolver->solve(initialState);
     unsigned int UB = min(UB_, bestFound->nRelocations());
     //
     unsigned int LB = currentState.LB3();
-    if ( verbose ) {
-        cout << "Starting builtin DFBB-loop with LB = "
+    if ( context().verbose ) {
+        log() << "Starting builtin DFBB-loop with LB = "
              << currentState.LB()
              << " and UB = " << UB << endl;
     }
-    cout << "Starting builtin depth-first branch-and-bound with LB = "
+    log() << "Starting builtin depth-first branch-and-bound with LB = "
          << currentState.LB()
          << " and UB = " << UB << endl;
     if (LB == UB) {
-        if ( verbose ) {
-            cout << "Done at root node!!" << endl;
+        if ( context().verbose ) {
+            log() << "Done at root node!!" << endl;
         }
         return bestFound;
     } else {
@@ -191,20 +639,20 @@ shared_ptr<BRPState> DFBBLoop::solve(const BRPState &initialState) const {
         while (UBcur < UB) {
             unsigned int bestObj = UBcur + 1;
             BRPState tmpState(initialState);
-            if ( verbose ) {
-                cout << "*** Trying with UB = " << bestObj << endl;
-                cout << "\t calling subroutine, timeLimit_ = " << timeLimit_
+            if ( context().verbose ) {
+                log() << "*** Trying with UB = " << bestObj << endl;
+                log() << "\t calling subroutine, timeLimit_ = " << timeLimit_
                      << endl;
             }
             
             bool finished = solveSub(tmpState, -1, bestFound, bestObj,
-                                     startTicks);
+                                     deadline);
             if (! finished) {
                 cerr << "DFBB-Loop: Time limit reached!" << endl;
                 return bestFound;
             }
-            if ( verbose ) { 
-                cout << "\tcurrent best found: " << bestFound->nRelocations()
+            if ( context().verbose ) { 
+                log() << "\tcurrent best found: " << bestFound->nRelocations()
                      << endl;
             }
             UB = min(UB, bestFound->nRelocations());
@@ -2,11 +2,84 @@
 #define DFBB_H
 
 // depth-first branch-and-bound
+// the search is iterative: the nodes between the root and the node being
+// explored are kept in a DFBBPath rather than on the call stack, so that
+// deep searches do not overflow it, and a search stopped by its deadline
+// can be written to a checkpoint file and resumed from there by a later run
+// the search can dive from some of its nodes with a heuristic, to improve
+// the incumbent as early as possible; the nodes are chosen by the schedule
+// of the context:
+// - depth:<d>: every node at depth d or less, the root being at depth 0
+// - gap:<g>: every node whose bound is at least g below the incumbent
+// - adaptive:<n> (n = 100 by default): one node every n nodes, times the
+//   number of dives so far and divided by the number of dives that improved
+//   the incumbent, both plus one; dives that fail become rarer
 
 #include <memory>
+#include <vector>
+#include <tuple>
 
 #include "brpstate.h"
 #include "brppolicy.h"
+#include "dominance.h"
+
+// dive schedule and parameter from depth:<d>, gap:<g>, adaptive or
+// adaptive:<n>; false if spec is none of these
+bool parseDiveSchedule(string spec, DiveSchedule &schedule, int &param);
+
+// a relocation to explore below a node
+struct DFBBBranch {
+    unsigned int bound;
+    // order among the branches with the same bound, lowest first, from the
+    // killer and history of the search
+    int rank;
+    unsigned int from;
+    int to;
+    // (item, destination low class) of the relocation, see DFBBPath
+    int record;
+
+    bool operator<(const DFBBBranch &other) const {
+        return tie(bound, rank, from, to) <
+            tie(other.bound, other.rank, other.from, other.to);
+    }
+};
+
+// node of the path from the root to the node being explored
+struct DFBBFrame {
+    // retrievals performed when entering the node
+    int nRetrievals = 0;
+    // relocations to explore below the node, most promising first
+    vector<DFBBBranch> branches;
+    // index of the next branch to explore; branches before it have been
+    // explored, except the last one when a deeper node is on the path
+    size_t next = 0;
+    // dominance rules at the node, after its retrievals
+    DominanceFilter dominance;
+    // record of the branch taken at this depth on the way to the last
+    // incumbent, -1 if none; kept from one node to the next at the same
+    // depth, the branches with this record are explored first
+    int killer = -1;
+};
+
+struct DFBBPath {
+    // frames[0] is the root; frames beyond depth are kept for their memory
+    vector<DFBBFrame> frames;
+    size_t depth = 0;
+    // operations of the state the search started from
+    size_t firstOp = 0;
+    // weight of every record in the improvements of the incumbent, the
+    // heavier first among branches with the same bound; a record is an
+    // item and the class of the low of the stack it is relocated to,
+    // which tells how it fits there
+    vector<int> history;
+    // adaptive dives: nodes to enter before the next one, dives made and
+    // those that improved the incumbent
+    long long nodesToDive = 0;
+    long long nDives = 0;
+    long long nImprovingDives = 0;
+
+    DFBBFrame &top() { return frames[depth - 1]; }
+};
 
 class DFBB: public BRPPolicy {
 public:
@@ -15,8 +88,17 @@ public:
     DFBB(unsigned int UB, unsigned int timeLimit);
     
     virtual string name() const { return "DFBB"; }
+
+    virtual bool exact() const { return true; }
     
-    virtual shared_ptr<BRPState> solve(const BRPState &initialState) const;
+    virtual shared_ptr<BRPState>
+    solve(const BRPState &initialState,
+          const Deadline &deadline = Deadline()) const;
+
+    // the search starts with incumbent as its UB
+    virtual shared_ptr<BRPState>
+    improve(const BRPState &initialState, shared_ptr<BRPState> incumbent,
+            const Deadline &deadline = Deadline()) const;
 
     // returns false if time limit reached, true otherwise
     // side effect: bestFound and bestObj are updated if a new better solution
@@ -25,18 +107,105 @@ public:
                           unsigned int lastRelocatedTo,
                           shared_ptr<BRPState> &bestFound,
                           unsigned int &bestObj,
-                          const clock_t &startTicks) const;
+                          Deadline &deadline) const;
+
+    // a search stopped by its deadline is saved to fName, and a search
+    // finding fName resumes from it; fName is removed once a search
+    // completes. Empty (the default) to disable.
+    void setCheckpoint(string fName) { checkpoint_ = fName; }
     
 protected:
     unsigned int UB_;
     unsigned int timeLimit_;
+    string checkpoint_;
+
+    // explore the tree below the nodes of path, or below currentState if
+    // path is empty, until it is done or deadline is reached
+    // on return, currentState is the state at the deepest node of path, and
+    // the search can be resumed by calling explore() again with both
+    bool explore(BRPState &currentState,
+                 unsigned int lastRelocatedTo,
+                 DFBBPath &path,
+                 shared_ptr<BRPState> &bestFound,
+                 unsigned int &bestObj,
+                 Deadline &deadline) const;
+
+    // push the node reached by the last move of currentState on path:
+    // perform its retrievals and generate its branches, unless it is a leaf
+    // or it is pruned
+    // returns false, leaving path and currentState unchanged, if deadline
+    // is reached
+    bool enter(BRPState &currentState,
+               unsigned int lastRelocatedTo,
+               DFBBPath &path,
+               shared_ptr<BRPState> &bestFound,
+               unsigned int &bestObj,
+               Deadline &deadline) const;
+
+    // promising relocations at currentState, most promising first, into
+    // the branches of frame, the node of path at currentState
+    void branch(const BRPState &currentState,
+                unsigned int lastRelocatedTo,
+                unsigned int bestObj,
+                const DFBBPath &path,
+                DFBBFrame &frame) const;
+
+    // the node being entered improves the incumbent: reward the branches
+    // leading to it in the history, and make them the killers; only
+    // improvements update them, not cutoffs (nodes pruned by bound or left
+    // without branches), which made the search larger on generated bays
+    void reward(DFBBPath &path) const;
+
+    // dive from currentState, the node being entered, with its bound, if
+    // the schedule of the context selects it; a better solution becomes
+    // the incumbent at once
+    void dive(const BRPState &currentState,
+              unsigned int bound,
+              DFBBPath &path,
+              shared_ptr<BRPState> &bestFound,
+              unsigned int &bestObj,
+              const Deadline &deadline) const;
+
+    // prepare the dominance rules of the node at depth d of path, which is
+    // at currentState, after its retrievals
+    void prepareDominance(const BRPState &currentState, DFBBPath &path,
+                          size_t d) const;
+
+    // save the search from initialState to checkpoint_, with the counters
+    // of the calling thread
+    void writeCheckpoint(const BRPState &initialState,
+                         const DFBBPath &path,
+                         const BRPState &bestFound,
+                         unsigned int bestObj) const;
+    // false if there is no checkpoint_; otherwise currentState and path are
+    // those of the checkpoint, so are bestFound and bestObj if they are
+    // better, and its counters are added to those of the calling thread
+    // exits if checkpoint_ is not a search from initialState
+    bool readCheckpoint(const BRPState &initialState,
+                        BRPState &currentState,
+                        DFBBPath &path,
+                        shared_ptr<BRPState> &bestFound,
+                        unsigned int &bestObj) const;
+
+    // search below initialState, bestFound being the best solution known
+    virtual shared_ptr<BRPState> search(const BRPState &initialState,
+                                        shared_ptr<BRPState> bestFound,
+                                        Deadline &deadline) const;
 };
 
 class DFBBLoop: public DFBB {
 public:
     DFBBLoop(unsigned int UB, unsigned int timeLimit);
     virtual string name() const { return "DFBB (loop)"; }
-    virtual shared_ptr<BRPState> solve(const BRPState &initialState) const;
+    virtual shared_ptr<BRPState>
+    solve(const BRPState &initialState,
+          const Deadline &deadline = Deadline()) const;
+
+protected:
+    // one DFBB run per UB, from the root LB up
+    virtual shared_ptr<BRPState> search(const BRPState &initialState,
+                                        shared_ptr<BRPState> bestFound,
+                                        Deadline &deadline) const;
     
 // protected:
 //     unsigned int UB_;
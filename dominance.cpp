@@ -0,0 +1,104 @@
+#include <sstream>
+
+#include "dominance.h"
+
+bool parseDominanceRules(string spec, unsigned int &rules) {
+    if ( spec == "all" ) {
+        rules = allDominanceRules;
+        return true;
+    } else if ( spec == "none" ) {
+        rules = 0;
+        return true;
+    }
+    rules = 0;
+    istringstream iss(spec);
+    string rule;
+    while ( getline(iss, rule, ',') ) {
+        if ( rule == "order" ) {
+            rules |= orderRule;
+        } else if ( rule == "transitive" ) {
+            rules |= transitiveRule;
+        } else if ( rule == "return" ) {
+            rules |= returnRule;
+        } else {
+            return false;
+        }
+    }
+    return rules != 0;
+}
+
+void DominanceFilter::reset(const BRPState &state, unsigned int rules,
+                            size_t firstOp) {
+    rules_ = rules;
+    setLast(state, firstOp);
+    if ( (rules & (transitiveRule | returnRule)) == 0 ) {
+        return;
+    }
+    lastOp_.assign(state.W(), -1);
+    movedFrom_.assign(state.W(), -1);
+    auto &ops = state.operations();
+    int nLeft = state.W();
+    for (int i = ops.size() - 1; i >= (int) firstOp && nLeft > 0; i--) {
+        int from = ops[i].first;
+        int to = ops[i].second;
+        if ( lastOp_[to] == -1 ) {
+            lastOp_[to] = i;
+            if ( from != to ) {
+                movedFrom_[to] = from;
+            }
+            nLeft -= 1;
+        }
+        if ( lastOp_[from] == -1 ) {
+            lastOp_[from] = i;
+            nLeft -= 1;
+        }
+    }
+}
+
+void DominanceFilter::follow(const DominanceFilter &parent,
+                             const BRPState &state, size_t nOps) {
+    rules_ = parent.rules_;
+    auto &ops = state.operations();
+    setLast(state, ops.size() - nOps);
+    if ( (rules_ & (transitiveRule | returnRule)) == 0 ) {
+        return;
+    }
+    lastOp_ = parent.lastOp_;
+    movedFrom_ = parent.movedFrom_;
+    for (int i = ops.size() - nOps; i < ops.size(); i++) {
+        int from = ops[i].first;
+        int to = ops[i].second;
+        lastOp_[from] = i;
+        lastOp_[to] = i;
+        movedFrom_[from] = -1;
+        if ( from != to ) {
+            movedFrom_[to] = from;
+        }
+    }
+}
+
+void DominanceFilter::setLast(const BRPState &state, size_t firstOp) {
+    lastFrom_ = -1;
+    lastTo_ = -1;
+    auto &ops = state.operations();
+    if ( (rules_ & orderRule) && ops.size() > firstOp &&
+         ops.back().first != ops.back().second &&
+         state.height(ops.back().second) > 1 ) {
+        lastFrom_ = ops.back().first;
+        lastTo_ = ops.back().second;
+    }
+}
+
+bool DominanceFilter::orderDominated(const BRPState &state, int sFrom,
+                                     int sTo) const {
+    if ( state.height(sTo) == 0 ) {
+        return false;
+    }
+    // the next item must still be blocked after this relocation
+    int h = state.height(sFrom);
+    if ( h >= 2 && state.itemAt(sFrom, h - 2) == state.next() ) {
+        return false;
+    }
+    COUNT(prunedByOrder);
+    return true;
+}
@@ -0,0 +1,87 @@
+#ifndef DOMINANCE_H
+#define DOMINANCE_H
+
+// dominance rules between relocation sequences, used by the exact methods
+// on top of never relocating from the stack relocated to last
+// each rule skips relocations such that, for every solution using them,
+// there is a solution that is as good and that the search still explores:
+// - order: two relocations in a row, with no retrieval in between, that
+//   involve four different stacks lead to the same state in both orders;
+//   only the one where (from, to) increases is explored, unless the second
+//   one lets the next item be retrieved or one of them goes to an empty
+//   stack (then, symmetry breaking on empty stacks decides)
+// - transitive: relocating an item that was relocated to its stack, when
+//   neither its stack nor the destination changed since, could have been
+//   done by the first relocation, which makes a solution shorter
+// - return: same, when the destination is the stack the item came from;
+//   both relocations can be removed
+// solutions that are not shorter than the optimum never break the last
+// two rules, and the first one only orders relocations that commute
+// in the restricted BRP, two relocations with no retrieval in between move
+// items from the same stack, so only the last two rules apply
+
+#include <vector>
+#include <string>
+
+#include "brpstate.h"
+#include "solvercontext.h"
+#include "counters.h"
+
+using namespace std;
+
+// rules from "all", "none" or a comma-separated list of order, transitive
+// and return; false if spec is none of these
+bool parseDominanceRules(string spec, unsigned int &rules);
+
+class DominanceFilter {
+public:
+    // prepare the queries at state, for a search that started after its
+    // first firstOp operations, which are not questioned
+    void reset(const BRPState &state, unsigned int rules, size_t firstOp);
+
+    // same, state being the state parent was prepared for followed by its
+    // last nOps operations; takes O(W + nOps) instead of a pass over the
+    // operations of the search
+    void follow(const DominanceFilter &parent, const BRPState &state,
+                size_t nOps);
+
+    // true if relocating from sFrom to sTo at state, the state given to
+    // reset() or follow(), is dominated; counted by rule
+    bool dominated(const BRPState &state, int sFrom, int sTo) const {
+        int from = (rules_ & (transitiveRule | returnRule)) ?
+            movedFrom_[sFrom] : -1;
+        if ( from >= 0 && lastOp_[sTo] <= lastOp_[sFrom] ) {
+            if ( from != sTo && (rules_ & transitiveRule) ) {
+                COUNT(prunedTransitive);
+                return true;
+            } else if ( from == sTo && (rules_ & returnRule) ) {
+                COUNT(prunedReturn);
+                return true;
+            }
+        }
+        return sFrom < lastFrom_ && sFrom != lastTo_ &&
+            sTo != lastFrom_ && sTo != lastTo_ &&
+            orderDominated(state, sFrom, sTo);
+    }
+
+protected:
+    unsigned int rules_;
+    // index of the last operation on every stack, -1 if there is none
+    // since the first operation of the search; only kept, with movedFrom_,
+    // for the transitive and return rules
+    vector<int> lastOp_;
+    // stack the top of every stack was relocated from by that operation,
+    // -1 if it was not a relocation to the stack
+    vector<int> movedFrom_;
+    // last operation if it is a relocation made by the search to a stack
+    // that was not empty, so that the order rule applies; -1 otherwise
+    int lastFrom_;
+    int lastTo_;
+
+    // set lastFrom_ and lastTo_
+    void setLast(const BRPState &state, size_t firstOp);
+    // rest of the order rule, once the stacks are known to be different
+    bool orderDominated(const BRPState &state, int sFrom, int sTo) const;
+};
+
+#endif
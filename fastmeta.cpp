@@ -1,18 +1,82 @@
+#include <thread>
+
 #include "fastmeta.h"
 #include "safemoves.h"
 #include "subsequence.h"
+#include "counters.h"
+
+FastMetaPolicy::FastMetaPolicy(bool parallel) : parallel_(parallel) {
+    heuristics_ = {
+        make_shared<SafeMovesPolicy>(1),
+        make_shared<SafeMovesPolicy>(2),
+        make_shared<SmartSubsequencePolicy>(1),
+        make_shared<SmartSubsequencePolicy>(2)
+    };
+}
+
+void FastMetaPolicy::setContext(shared_ptr<const SolverContext> context) {
+    BRPPolicy::setContext(context);
+    for (auto h: heuristics_) {
+        h->setContext(context);
+    }
+}
 
 // return number of moves necessary to empty the bay
-shared_ptr<BRPState> FastMetaPolicy::solve(const BRPState &s1) const {
-    vector<shared_ptr<BRPPolicy> > heuristics( {
-            make_shared<SafeMovesPolicy>(1),
-                make_shared<SafeMovesPolicy>(2),
-                make_shared<SmartSubsequencePolicy>(1),
-                make_shared<SmartSubsequencePolicy>(2)
-                } );
+shared_ptr<BRPState> FastMetaPolicy::solve(const BRPState &s1,
+                                           const Deadline &deadline) const {
+    if (parallel_) {
+        return solveParallel(s1, deadline);
+    } else {
+        return solveSequential(s1, deadline);
+    }
+}
+
+shared_ptr<BRPState> FastMetaPolicy::
+solveSequential(const BRPState &s1, const Deadline &deadline) const {
+    // no member can do better than this
+    unsigned int LB = s1.nRelocations() + s1.LB();
+    shared_ptr<BRPState> best = NULL;
+    for (auto thisHeuristic: heuristics_) {
+        auto thisResult = thisHeuristic->solve(s1, deadline);
+        if ( best == NULL ||
+             thisResult->nRelocations() < best->nRelocations() ) {
+            best = thisResult;
+        }
+        if ( best->nRelocations() <= LB || deadline.reached() ) {
+            break;
+        }
+    }
+    return best;
+}
+
+shared_ptr<BRPState> FastMetaPolicy::
+solveParallel(const BRPState &s1, const Deadline &deadline) const {
+    unsigned int LB = s1.nRelocations() + s1.LB();
+    vector<shared_ptr<BRPState> > results(heuristics_.size());
+    // one deadline per member, so that members can be cancelled separately
+    vector<Deadline> memberDeadlines;
+    for (unsigned int i=0; i < heuristics_.size(); i++) {
+        memberDeadlines.push_back(deadline.child());
+    }
+    vector<thread> threads;
+    for (unsigned int i=0; i < heuristics_.size(); i++) {
+        threads.push_back( thread( [&, i]() {
+                    results[i] = heuristics_[i]->solve(s1, memberDeadlines[i]);
+                    // members after this one cannot win any more
+                    if ( results[i]->nRelocations() <= LB ) {
+                        for (unsigned int j=i+1; j < heuristics_.size(); j++) {
+                            memberDeadlines[j].cancel();
+                        }
+                    }
+                    Counters::mergeThread();
+                } ) );
+    }
+    for (auto &t: threads) {
+        t.join();
+    }
+    // same tie-breaking as the sequential mode: first member wins
     shared_ptr<BRPState> best = NULL;
-    for (auto thisHeuristic: heuristics) {
-        auto thisResult = thisHeuristic->solve(s1);
+    for (auto thisResult: results) {
         if ( best == NULL ||
              thisResult->nRelocations() < best->nRelocations() ) {
             best = thisResult;
@@ -5,12 +5,35 @@
 
 class FastMetaPolicy: public BRPPolicy {
 public:
-    FastMetaPolicy() {}
-    virtual string name() const { return "FastMetaPolicy"; }
+    // parallel: member heuristics race on separate threads instead of
+    // being run one after another
+    FastMetaPolicy(bool parallel = false);
+    virtual string name() const {
+        return parallel_ ? "FastMetaPolicy (parallel)" : "FastMetaPolicy";
+    }
 
     // return number of moves necessary to empty the bay
-    virtual shared_ptr<BRPState> solve(const BRPState &s1) const;
-    
+    virtual shared_ptr<BRPState>
+    solve(const BRPState &s1,
+          const Deadline &deadline = Deadline()) const;
+
+    virtual void setContext(shared_ptr<const SolverContext> context);
+
+protected:
+    bool parallel_;
+
+    // member heuristics, built once and reused by every call to solve()
+    vector<shared_ptr<BRPPolicy> > heuristics_;
+
+    // run members in order, stopping as soon as one reaches the LB or the
+    // deadline is reached
+    shared_ptr<BRPState> solveSequential(const BRPState &s1,
+                                         const Deadline &deadline) const;
+
+    // run all members at once, one thread each; when a member reaches the
+    // LB, the members after it are cancelled
+    shared_ptr<BRPState> solveParallel(const BRPState &s1,
+                                       const Deadline &deadline) const;
 };
 
 #endif
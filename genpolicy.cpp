@@ -1,16 +1,21 @@
 #include <iostream>
+#include <algorithm>
 
 #include "genpolicy.h"
 
 using namespace std;
 
-unique_ptr<BRPPolicy> genPolicy(string name,
-                                const BRPState &s,
-                                int timeLimit,
-                                string bbStrategy,
-                                bool mustBeHeuristic) {
-    if (name == "LA-S-1") {
-        return make_unique<LA_N>(s.W() - 1);
+static unique_ptr<BRPPolicy> newPolicy(string name,
+                                       int timeLimit,
+                                       string bbStrategy,
+                                       bool mustBeHeuristic,
+                                       unsigned int nThreads) {
+    if ( ! validPolicyName(name, mustBeHeuristic) ) {
+        cerr << "Invalid policy: " << name << endl;
+        cerr << "mustBeHeuristic = " << mustBeHeuristic << endl;
+        exit(22);
+    } else if (name == "LA-S-1") {
+        return LA_N::allButOneStack();
     } else if (name.substr(0, 3) == "LA-") {
         return make_unique<LA_N>(stoi(name.substr(3)));
     } else if (name.substr(0, 3) == "SM-") {
@@ -28,9 +33,11 @@ unique_ptr<BRPPolicy> genPolicy(string name,
     } else if (name == "ZHU") {
         return make_unique<Zhu>(Zhu());
     } else if (name.substr(0, 5) == "GLAH-") {
-        return make_unique<GLAH>(stoi(name.substr(5)));
+        return make_unique<GLAH>(stoi(name.substr(5)), nThreads);
     } else if (name == "FM") {
         return make_unique<FastMetaPolicy>(FastMetaPolicy());
+    } else if (name == "FM-P") {
+        return make_unique<FastMetaPolicy>(true);
         // exact methods follow
     } else if (name == "BB" && ! mustBeHeuristic) {
         return make_unique<BranchAndBound>(1e9, bbStrategy, timeLimit);
@@ -44,3 +51,84 @@ unique_ptr<BRPPolicy> genPolicy(string name,
         exit(22);
     }
 }
+
+unique_ptr<BRPPolicy> genPolicy(string name,
+                                shared_ptr<const SolverContext> context,
+                                int timeLimit,
+                                string bbStrategy,
+                                bool mustBeHeuristic,
+                                unsigned int nThreads) {
+    auto policy = newPolicy(name, timeLimit, bbStrategy, mustBeHeuristic,
+                            nThreads);
+    policy->setContext(context);
+    return policy;
+}
+
+shared_ptr<const SolverContext>
+makeSolverContext(string ubMethod,
+                  string hubMethod,
+                  string condensationProcedure,
+                  bool verbose,
+                  bool quiet,
+                  unsigned int dominanceRules,
+                  bool restricted,
+                  string diveMethod,
+                  string diveSchedule) {
+    static NullBuffer nullBuffer;
+    static ostream nullStream(&nullBuffer);
+    // the UB procedures get a context without themselves, so that contexts
+    // and policies do not own each other; the pilot method can still be
+    // used as ubMethod
+    auto hubContext = make_shared<SolverContext>();
+    hubContext->verbose = verbose;
+    hubContext->condensationProcedure = condensationProcedure;
+    hubContext->dominanceRules = dominanceRules;
+    hubContext->restricted = restricted;
+    hubContext->log = quiet ? &nullStream : &cout;
+    auto hub = genPolicy(hubMethod, hubContext, 0, "depth", true);
+    auto ubContext = make_shared<SolverContext>(*hubContext);
+    ubContext->hubSolver = move(hub);
+    auto ub = genPolicy(ubMethod, ubContext, 0, "depth", true);
+    auto context = make_shared<SolverContext>(*ubContext);
+    context->ubSolver = move(ub);
+    if ( diveMethod != "" ) {
+        // dives use the context of the UB procedures, as they are one
+        context->diveSolver = genPolicy(diveMethod, ubContext, 0, "depth",
+                                        true);
+        if ( ! parseDiveSchedule(diveSchedule, context->diveSchedule,
+                                 context->diveParam) ) {
+            cerr << "unknown dive schedule: " << diveSchedule << endl;
+            exit(22);
+        }
+    }
+    return context;
+}
+
+bool validPolicyName(string name, bool mustBeHeuristic) {
+    const vector<string> fixedNames = { "LA-S-1", "SSEQ", "JZW", "ZHU", "FM",
+                                        "FM-P" };
+    const vector<string> exactNames = { "BB", "DFBB", "DFBB-L" };
+    // followed by a number
+    const vector<string> prefixes = { "LA-", "SM-", "RS-", "SmSEQ-", "PM-",
+                                      "GLAH-" };
+    if ( find(fixedNames.begin(), fixedNames.end(), name) !=
+         fixedNames.end() ) {
+        return true;
+    }
+    if ( find(exactNames.begin(), exactNames.end(), name) !=
+         exactNames.end() ) {
+        return ! mustBeHeuristic;
+    }
+    // from 1 to 10000, so that the policies can be built
+    for (auto prefix: prefixes) {
+        if ( name.size() > prefix.size() &&
+             name.size() <= prefix.size() + 5 &&
+             name.compare(0, prefix.size(), prefix) == 0 &&
+             name.find_first_not_of("0123456789", prefix.size()) ==
+             string::npos ) {
+            int parameter = stoi(name.substr(prefix.size()));
+            return parameter >= 1 && parameter <= 10000;
+        }
+    }
+    return false;
+}
@@ -16,10 +16,29 @@
 #include "fastmeta.h"
 #include "glah.h"
 
+// the policy and the policies it is made of use context
 unique_ptr<BRPPolicy> genPolicy(string name,
-                                const BRPState &s,
+                                shared_ptr<const SolverContext> context,
                                 int timeLimit=0,
                                 string bbStrategy="depth",
-                                bool mustBeHeuristic=false);
+                                bool mustBeHeuristic=false,
+                                unsigned int nThreads=1);
+
+// context with ubMethod and hubMethod as UB procedures; a quiet context
+// does not report progress
+shared_ptr<const SolverContext>
+makeSolverContext(string ubMethod="LA-1",
+                  string hubMethod="FM",
+                  string condensationProcedure="tricoire",
+                  bool verbose=false,
+                  bool quiet=false,
+                  unsigned int dominanceRules=allDominanceRules,
+                  bool restricted=false,
+                  string diveMethod="",
+                  string diveSchedule="adaptive");
+
+// true if genPolicy() accepts name, which it would exit on otherwise; the
+// number of a name such as LA-<N> must be from 1 to 10000
+bool validPolicyName(string name, bool mustBeHeuristic=false);
 
 #endif
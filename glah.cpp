@@ -1,18 +1,19 @@
 #include <algorithm>
 #include <cmath>
+#include <thread>
 
 #include "glah.h"
-
-extern bool verbose;
+#include "counters.h"
 
 // used as UB
-shared_ptr<BRPState> JZW::solve(const BRPState &initialState) const {
+shared_ptr<BRPState> JZW::solve(const BRPState &initialState,
+                                const Deadline &deadline) const {
     BRPState state(initialState);
     autoRetrieve(state);
     while (! state.empty()) {
         int cStar = state.next();
         unsigned int sStar = state.stackForItem(cStar);
-        while (state.top(sStar) != cStar) {
+        while (state.depth(cStar) > 0) {
             int c = state.top(sStar);
 
         // cout << state << endl;
@@ -21,17 +22,7 @@ shared_ptr<BRPState> JZW::solve(const BRPState &initialState) const {
         // cout << "c = " << c << endl;
             
             // look for stacks that can support c
-            int sPrime = -1;
-            for (int s=0; s < state.W(); s++) {
-                if ( s != sStar &&
-                     state.height(s) < state.H() &&
-                     state.low(s) >= c ) {
-                    if ( sPrime == -1 ||
-                         state.low(s) < state.low(sPrime) ) {
-                        sPrime = s;
-                    }
-                }
-            }
+            int sPrime = state.nonFullStackFrom(c, sStar);
             // case where S1 is not empty
             if (sPrime > -1) {
                 // cout << "S1 not empty!" << endl;
@@ -47,19 +38,13 @@ shared_ptr<BRPState> JZW::solve(const BRPState &initialState) const {
                          state.height(s) >= 1 &&
                          state.top(s) <= state.f(s) &&
                          c <= state.f(s) ) {
-                        for (int t=0; t < state.W(); t++) {
-                            if ( t != sStar &&
-                                 t != s &&
-                                 state.height(t) < state.H() &&
-                                 state.low(t) >= state.top(s) ) {
-                                if ( sPrime == -1 ||
-                                     state.top(s) > state.top(sPrime) ||
-                                     ( state.top(s) >= state.top(sPrime) &&
-                                       state.low(t) < state.low(sa) ) ) {
-                                    sPrime = s;
-                                    sa = t;
-                                }
-                            }
+                        // stack with the smallest low that can support top(s)
+                        int t = state.nonFullStackFrom(state.top(s), sStar, s);
+                        if ( t != -1 &&
+                             ( sPrime == -1 ||
+                               state.top(s) > state.top(sPrime) ) ) {
+                            sPrime = s;
+                            sa = t;
                         }
                     }
                 } // case where S2 is not empty
@@ -77,20 +62,17 @@ shared_ptr<BRPState> JZW::solve(const BRPState &initialState) const {
                 } else { // general case: we have to consider FT-BB relocations
                     // cout << "S1 and S2 both empty!" << endl;
                     int smallestAbove = state.smallestAbove(cStar);
-                    vector<pair<int, int> > minAndStack;
-                    for (int s=0; s < state.W(); s++) {
-                        if ( s != sStar &&
-                             state.height(s) < state.H() ) {
-                            minAndStack.push_back(make_pair(state.low(s), s));
-                        }
-                    }
-                    sort(minAndStack.begin(), minAndStack.end());
                     // we want the stack with the largest min
-                    sPrime = minAndStack.rbegin()->second;
+                    sPrime = state.nonFullStackBelow(state.n() + 2, sStar);
                     // special case as in Jin et al.
                     if ( state.height(sPrime) == state.H() - 1 &&
                          c != smallestAbove ) {
-                        sPrime = (minAndStack.rbegin() + 1)->second;
+                        int second =
+                            state.nonFullStackBelow(state.n() + 2, sStar,
+                                                    sPrime);
+                        if ( second != -1 ) {
+                            sPrime = second;
+                        }
                     }
                     state.relocate(sStar, sPrime);
                     // cout << "\trelocating from " << sStar
@@ -111,17 +93,7 @@ pair<int, int> JZW::solveOnlyOne(const BRPState &initialState) const {
     unsigned int sStar = state.stackForItem(cStar);
     int c = state.top(sStar);
     // look for stacks that can support c
-    int sPrime = -1;
-    for (int s=0; s < state.W(); s++) {
-        if ( s != sStar &&
-             state.height(s) < state.H() &&
-             state.low(s) >= c ) {
-            if ( sPrime == -1 ||
-                 state.low(s) < state.low(sPrime) ) {
-                sPrime = s;
-            }
-        }
-    }
+    int sPrime = state.nonFullStackFrom(c, sStar);
     // case where S1 is not empty
     if (sPrime > -1) {
         auto nextReloc = gapUtilizeOnlyOne(state, sStar, sPrime);
@@ -139,19 +111,12 @@ pair<int, int> JZW::solveOnlyOne(const BRPState &initialState) const {
                  state.height(s) >= 1 &&
                  state.top(s) <= state.f(s) &&
                  c <= state.f(s) ) {
-                for (int t=0; t < state.W(); t++) {
-                    if ( t != sStar &&
-                         t != s &&
-                         state.height(t) < state.H() &&
-                         state.low(t) >= state.top(s) ) {
-                        if ( sPrime == -1 ||
-                             state.top(s) > state.top(sPrime) ||
-                             ( state.top(s) >= state.top(sPrime) &&
-                               state.low(t) < state.low(sa) ) ) {
-                            sPrime = s;
-                            sa = t;
-                        }
-                    }
+                // stack with the smallest low that can support top(s)
+                int t = state.nonFullStackFrom(state.top(s), sStar, s);
+                if ( t != -1 &&
+                     ( sPrime == -1 || state.top(s) > state.top(sPrime) ) ) {
+                    sPrime = s;
+                    sa = t;
                 }
             }
         } // case where S2 is not empty
@@ -166,20 +131,16 @@ pair<int, int> JZW::solveOnlyOne(const BRPState &initialState) const {
         } else { // general case: we have to consider FT-BB relocations
             // cout << "S1 and S2 both empty!" << endl;
             int smallestAbove = state.smallestAbove(cStar);
-            vector<pair<int, int> > minAndStack;
-            for (int s=0; s < state.W(); s++) {
-                if ( s != sStar &&
-                     state.height(s) < state.H() ) {
-                    minAndStack.push_back(make_pair(state.low(s), s));
-                }
-            }
-            sort(minAndStack.begin(), minAndStack.end());
             // we want the stack with the largest min
-            sPrime = minAndStack.rbegin()->second;
+            sPrime = state.nonFullStackBelow(state.n() + 2, sStar);
             // special case as in Jin et al.
             if ( state.height(sPrime) == state.H() - 1 &&
                  c != smallestAbove ) {
-                sPrime = (minAndStack.rbegin() + 1)->second;
+                int second = state.nonFullStackBelow(state.n() + 2, sStar,
+                                                     sPrime);
+                if ( second != -1 ) {
+                    sPrime = second;
+                }
             }
             return make_pair(sStar, sPrime);
         }
@@ -192,17 +153,9 @@ pair<int, int> JZW::gapUtilizeOnlyOne(BRPState &state,
                                          unsigned int s1,
                                          unsigned int s2) const {
     while ( state.height(s2) <= state.H() - 2 ) {
-        int s3 = -1;
-        for (int s=0; s < state.W(); s++) {
-            if ( s != s1 && s != s2 && state.height(s) > 1 &&
-                 state.top(s) > state.f(s) &&
-                 state.top(s1) <= state.top(s) &&
-                 state.top(s) <= state.low(s2) ) {
-                if ( s3 == -1 || state.top(s) >= state.top(s3) ) {
-                    s3 = s;
-                }
-            }
-        }
+        // largest badly placed item that s2 can support
+        int item = state.badTopUpTo(state.top(s1), state.low(s2), s1, s2);
+        int s3 = item == -1 ? -1 : state.stackForItem(item);
         if ( s3 == -1 ) {
             return make_pair(-1, -1);
         } else {
@@ -212,8 +165,36 @@ pair<int, int> JZW::gapUtilizeOnlyOne(BRPState &state,
     return make_pair(-1, -1);
 }
 
-GLAH::GLAH(unsigned int level) {
+GLAHIncumbent::GLAHIncumbent(shared_ptr<BRPState> solution) :
+    solution_(solution), rank_(-1) {
+    setKey(solution->nRelocations(), -1);
+}
+
+shared_ptr<BRPState> GLAHIncumbent::solution() const {
+    lock_guard<mutex> lock(mutex_);
+    return solution_;
+}
+
+void GLAHIncumbent::offer(shared_ptr<BRPState> solution, int rank) {
+    lock_guard<mutex> lock(mutex_);
+    if ( solution->nRelocations() < solution_->nRelocations() ||
+         ( solution->nRelocations() == solution_->nRelocations() &&
+           rank_ != -1 && rank < rank_ ) ) {
+        solution_ = solution;
+        rank_ = rank;
+        setKey(solution->nRelocations(), rank);
+    }
+}
+
+void GLAHIncumbent::newTreeSearch() {
+    lock_guard<mutex> lock(mutex_);
+    rank_ = -1;
+    setKey(solution_->nRelocations(), -1);
+}
+
+GLAH::GLAH(unsigned int level, unsigned int nThreads) {
     D_ = level;
+    nThreads_ = nThreads;
     // following the Jin et al. article
     nFTBG_ = 5;
     nNFBG_ = 5;
@@ -228,17 +209,9 @@ void JZW::gapUtilize(BRPState &state,
                        unsigned int s1, unsigned int s2) const {
     // cout << "\tIn Gap-utilize with s1 = " << s1 << " and s2 = " << s2 << endl;
     while ( state.height(s2) <= state.H() - 2 ) {
-        int s3 = -1;
-        for (int s=0; s < state.W(); s++) {
-            if ( s != s1 && s != s2 && state.height(s) > 1 &&
-                 state.top(s) > state.f(s) &&
-                 state.top(s1) <= state.top(s) &&
-                 state.top(s) <= state.low(s2) ) {
-                if ( s3 == -1 || state.top(s) >= state.top(s3) ) {
-                    s3 = s;
-                }
-            }
-        }
+        // largest badly placed item that s2 can support
+        int item = state.badTopUpTo(state.top(s1), state.low(s2), s1, s2);
+        int s3 = item == -1 ? -1 : state.stackForItem(item);
         if ( s3 == -1 ) {
             return;//break;
         } else {
@@ -248,10 +221,20 @@ void JZW::gapUtilize(BRPState &state,
     }
 }
 
-// wrapped by solve()
-shared_ptr<BRPState> GLAH::greedy(const BRPState &initialState) const {
-    
-    auto solBest = ubSolver_.solve(initialState);
+// wrapped by solve() and improve()
+shared_ptr<BRPState> GLAH::greedy(const BRPState &initialState,
+                                  shared_ptr<BRPState> incumbent,
+                                  const Deadline &callerDeadline) const {
+    // polled at every node of the tree searches, which leave it expired
+    // when they stop for lack of time
+    Deadline deadline(callerDeadline);
+
+    shared_ptr<BRPState> first = ubSolver_.solve(initialState);
+    if ( incumbent != NULL &&
+         incumbent->nRelocations() < first->nRelocations() ) {
+        first = incumbent;
+    }
+    GLAHIncumbent solBest(first);
 
     // cout << "Initialised solBest, nRelocations =  "
     //      << solBest->nRelocations() << endl;
@@ -259,8 +242,13 @@ shared_ptr<BRPState> GLAH::greedy(const BRPState &initialState) const {
     // incumbent
     BRPState Lcurr(initialState);
     autoRetrieve(Lcurr);
+    // tree evaluated so far below Lcurr
+    unique_ptr<GLAHNode> root = make_unique<GLAHNode>();
     while (! Lcurr.empty() ) {
-        if ( Lcurr.nRelocations() + Lcurr.LB() >= solBest->nRelocations() ) {
+        if ( Lcurr.nRelocations() + Lcurr.LB() >= solBest.nRelocations() ) {
+            break;
+        }
+        if ( deadline.reached() ) {
             break;
         }
 
@@ -271,16 +259,20 @@ shared_ptr<BRPState> GLAH::greedy(const BRPState &initialState) const {
         //     cout << "solBest->nRelocations() = " << solBest->nRelocations() << endl;
         // }
         
-        tuple<int, int, int> relo = lookAheadAdvice(Lcurr, solBest);
+        tuple<int, int, int> relo = lookAheadAdvice(Lcurr, solBest, *root,
+                                                    deadline);
         // cout << endl << "Look-ahead advice: " << get<0>(relo) << " --> " << get<1>(relo)
         //      << endl;
 
-        // no advice!
-        if ( get<0>(relo) == -1 ) {
+        // no advice! (or not a complete one)
+        if ( get<0>(relo) == -1 || deadline.reached() ) {
             break;
         }
         
         Lcurr.relocate( get<0>(relo), get<1>(relo) );
+        // the subtree below the advised relocation has already been
+        // evaluated one level less deep than the next tree search
+        root = move(root->children[root->bestChild]);
 
         // exit(0);
         
@@ -290,50 +282,70 @@ shared_ptr<BRPState> GLAH::greedy(const BRPState &initialState) const {
         
         autoRetrieve( Lcurr );
     }
-    return solBest;
+    return solBest.solution();
 }
 
 // as in the article
 // side-effect: solBest if updated if necessary
 // (in the article, it is a global variable)
 tuple<int, int, int> GLAH::lookAheadAdvice(const BRPState &state,
-                                          shared_ptr<BRPState> &solBest) const {
+                                           GLAHIncumbent &solBest,
+                                           GLAHNode &root,
+                                           Deadline &deadline) const {
     BRPState L0(state);
-    return treeSearch(0, L0, solBest);
+    solBest.newTreeSearch();
+    return treeSearch(0, L0, solBest, 0, root, deadline);
 }
 
 // format: <from, to, cost>
 // side-effect: solBest if updated if necessary
 // (in the article, it is a global variable)
 tuple<int, int, int> GLAH::treeSearch(int d,
-                                     const  BRPState &Ld,
-                                     shared_ptr<BRPState> &solBest) const {
+                                      const  BRPState &Ld,
+                                      GLAHIncumbent &solBest,
+                                      int rank,
+                                      GLAHNode &node,
+                                      Deadline &deadline) const {
     
     // if (verbose) {
     //     for (int i=0; i < d; i++) { cout << "\t"; }
     //     cout << "-*-  ";
     // }
     
+    // out of time: the caller ignores the result
+    if ( deadline.poll() ) {
+        return make_tuple(-1, -1, -1);
+    }
+    COUNT(nodes);
+    // the bay of a node does not change between tree searches
+    if ( node.bound == -1 ) {
+        node.bound = Ld.nRelocations() + Ld.LB();
+    }
     // termination case 1
-    if ( Ld.nRelocations() + Ld.LB() >= solBest->nRelocations() ) {
+    if ( node.pruned || solBest.prunes(node.bound, rank) ) {
         
         // if (verbose) {
         //     cout << "Termination 1: unpromising" << endl;
         // }
 
+        COUNT(prunedByBound);
+        node.pruned = true;
+        node.children.clear();
         return make_tuple(-1, -1, -1);        
     } else if ( Ld.empty() || d == D_ ) { // termination case 2
-        auto solEva = ubSolver_.solve(Ld);
-        solEva->condenseJin();
-        if ( solBest->nRelocations() > solEva->nRelocations() ) {
-            solBest = solEva;
-
-            // if (!verbose) {
-            // cout << "New best solution: "
-            //      << solEva->nRelocations() << " relocations" << endl;
-            // }
-            
+        // the evaluation of an empty bay does not change between tree
+        // searches
+        auto solEva = node.solution;
+        if ( solEva == NULL ) {
+            COUNT(heuristicRollouts);
+            solEva = ubSolver_.solve(Ld);
+            solEva->condenseJin(deadline);
+            if ( Ld.empty() ) {
+                node.solution = solEva;
+            }
         }
+        node.cost = solEva->nRelocations();
+        solBest.offer(solEva, rank);
 
         // if (verbose) {
         //     cout << "Termination 2: condensed solution with "
@@ -348,23 +360,45 @@ tuple<int, int, int> GLAH::treeSearch(int d,
         // }
         
         int bestFrom=-1, bestTo=-1, bestCost=pow(Ld.n(), 2);
-        // generate relocations here
-        vector<pair<int, int> > reloList = genReloList(Ld);
+        // generate relocations here, unless a previous tree search did
+        if ( ! node.expanded ) {
+            node.relos = genReloList(Ld);
+            for (int i=0; i < node.relos.size(); i++) {
+                node.children.push_back(make_unique<GLAHNode>());
+            }
+            node.expanded = true;
+        }
+        const vector<pair<int, int> > &reloList = node.relos;
+        // root subtrees only share solBest, so they can be evaluated
+        // concurrently
+        vector<int> childCost;
+        if ( d == 0 && nThreads_ > 1 ) {
+            childCost = evaluateRootsInParallel(Ld, solBest, node, deadline);
+        }
         // now evaluate every child
-        for (auto relo: reloList) {
-            // cout << "Looking at relocation: " << relo.first << " --> "
-            //      << relo.second << endl;
-            BRPState Lnext(Ld);
+        node.bestChild = -1;
+        for (int i=0; i < reloList.size(); i++) {
+            auto relo = reloList[i];
+            tuple<int, int, int> child;
+            if ( ! childCost.empty() ) {
+                child = make_tuple(-1, -1, childCost[i]);
+            } else {
+                // cout << "Looking at relocation: " << relo.first << " --> "
+                //      << relo.second << endl;
+                BRPState Lnext(Ld);
 
-            // if (verbose) {
-            //     for (int i=0; i < d; i++) { cout << "\t"; }
-            //     cout << "     " << relo.first << " --> "
-            //          <<  relo.second << endl;
-            // }
-            
-            Lnext.relocate(relo.first, relo.second);
-            autoRetrieve(Lnext);
-            auto child = treeSearch( d + 1, Lnext, solBest );
+                // if (verbose) {
+                //     for (int i=0; i < d; i++) { cout << "\t"; }
+                //     cout << "     " << relo.first << " --> "
+                //          <<  relo.second << endl;
+                // }
+
+                Lnext.relocate(relo.first, relo.second);
+                autoRetrieve(Lnext);
+                child = treeSearch( d + 1, Lnext, solBest,
+                                    d == 0 ? i : rank, *node.children[i],
+                                    deadline );
+            }
             if ( get<2>(child) != -1 && bestCost > get<2>(child) ) {
 
                 // if (verbose) {
@@ -376,12 +410,48 @@ tuple<int, int, int> GLAH::treeSearch(int d,
                 bestFrom = relo.first;
                 bestTo = relo.second;
                 bestCost = get<2>(child);
+                node.bestChild = i;
             }
         }
+        node.cost = bestCost;
         return make_tuple(bestFrom, bestTo, bestCost);
     }
 }
 
+// cost of the subtree below each child of node, or -1 if it is pruned
+vector<int> GLAH::evaluateRootsInParallel(const BRPState &state,
+                                          GLAHIncumbent &solBest,
+                                          GLAHNode &node,
+                                          Deadline &deadline) const {
+    const vector<pair<int, int> > &relos = node.relos;
+    vector<int> result(relos.size(), -1);
+    // each thread takes the next root subtree that nobody is working on
+    atomic<unsigned int> nextRelo(0);
+    auto worker = [&]() {
+        // each thread polls its own copy
+        Deadline threadDeadline(deadline);
+        unsigned int i;
+        while ( (i = nextRelo++) < relos.size() ) {
+            BRPState Lnext(state);
+            Lnext.relocate(relos[i].first, relos[i].second);
+            autoRetrieve(Lnext);
+            result[i] = get<2>(treeSearch(1, Lnext, solBest, i,
+                                          *node.children[i],
+                                          threadDeadline));
+        }
+        Counters::mergeThread();
+    };
+    vector<thread> threads;
+    unsigned int nThreads = min<size_t>(nThreads_, relos.size());
+    for (unsigned int t=0; t < nThreads; t++) {
+        threads.push_back(thread(worker));
+    }
+    for (auto &t: threads) {
+        t.join();
+    }
+    return result;
+}
+
 // generate list of relocations for tree search
 vector<pair<int, int> > GLAH::genReloList(const BRPState &state) const {
 
@@ -4,6 +4,8 @@
 // depth-first branch-and-bound
 
 #include <memory>
+#include <atomic>
+#include <mutex>
 
 #include "brpstate.h"
 #include "brppolicy.h"
@@ -14,7 +16,9 @@ public:
     
     virtual string name() const { return "Jin et al. UB subroutine"; }
     
-    virtual shared_ptr<BRPState> solve(const BRPState &initialState) const;
+    virtual shared_ptr<BRPState>
+    solve(const BRPState &initialState,
+          const Deadline &deadline = Deadline()) const;
     // returns the next relocation that the heuristic would perform
     pair<int, int> solveOnlyOne(const BRPState &initialState) const;
 
@@ -41,21 +45,108 @@ protected:
                             unsigned int s1, unsigned int s2) const {}
 };
 
+// best solution known during a GLAH run
+// shared by the root subtrees of the tree search when they are evaluated
+// concurrently
+class GLAHIncumbent {
+public:
+    GLAHIncumbent(shared_ptr<BRPState> solution);
+
+    // number of relocations in the incumbent
+    unsigned int nRelocations() const { return key_.load() >> 32; }
+
+    // true if a node of root subtree rank with that bound is pruned: its
+    // bound reaches the incumbent, or exceeds it when the incumbent comes
+    // from a later root subtree, which a sequential search would not know
+    // about yet; with a tie, the node could still give the incumbent
+    bool prunes(unsigned int bound, int rank) const {
+        unsigned long long key = key_.load();
+        unsigned int nRelocations = key >> 32;
+        int incumbentRank = (int) (key & 0xffffffff) - 1;
+        return bound > nRelocations ||
+            ( bound == nRelocations && incumbentRank <= rank );
+    }
+
+    shared_ptr<BRPState> solution() const;
+
+    // replace the incumbent if solution is better
+    // rank is the index of the root subtree where solution was found; in case
+    // of a tie the lowest rank wins, which is what a sequential search
+    // exploring root subtrees in order would keep
+    void offer(shared_ptr<BRPState> solution, int rank);
+
+    // start a new tree search: the incumbent is not replaced in case of a tie
+    void newTreeSearch();
+
+protected:
+    mutable mutex mutex_;
+    shared_ptr<BRPState> solution_;
+    // number of relocations of the incumbent, then its rank plus one,
+    // read at once by prunes()
+    atomic<unsigned long long> key_;
+    int rank_;
+
+    void setKey(unsigned int nRelocations, int rank) {
+        key_.store(((unsigned long long) nRelocations << 32) | (rank + 1));
+    }
+};
+
+// node of the GLAH tree search
+// the subtree below the relocation chosen by a look-ahead advice is kept for
+// the next advice: its nodes keep their bound, relocations and children,
+// only the new deepest level is evaluated by the UB procedure, and the costs
+// of the other nodes are taken again from their children
+class GLAHNode {
+public:
+    GLAHNode() : pruned(false), bound(-1), expanded(false), cost(-1),
+                 bestChild(-1) {}
+
+    // pruned nodes remain pruned since the incumbent can only improve
+    bool pruned;
+    // relocations so far plus the LB of the bay, -1 until computed
+    int bound;
+    // true once relos and children have been generated
+    bool expanded;
+    // cost of the subtree at its last evaluation
+    int cost;
+    // index of the child with the lowest cost, -1 if none
+    int bestChild;
+    // relocations leading to children, as given by genReloList()
+    vector<pair<int, int> > relos;
+    vector<unique_ptr<GLAHNode> > children;
+    // evaluated solution when the node is a leaf because its bay is empty
+    shared_ptr<BRPState> solution;
+};
+
 class GLAH: public BRPPolicy {
 public:
 
-    GLAH(unsigned int level = 3);
+    // nThreads > 1: root subtrees of the tree search are evaluated
+    // concurrently
+    GLAH(unsigned int level = 3, unsigned int nThreads = 1);
     
     virtual string name() const { return "Jin et al. GLAH method"; }
     
-    virtual shared_ptr<BRPState> solve(const BRPState &initialState) const {
-        return greedy(initialState);
+    virtual shared_ptr<BRPState>
+    solve(const BRPState &initialState,
+          const Deadline &deadline = Deadline()) const {
+        return greedy(initialState, NULL, deadline);
+    }
+
+    // incumbent replaces the first JZW solution if it is better
+    virtual shared_ptr<BRPState>
+    improve(const BRPState &initialState, shared_ptr<BRPState> incumbent,
+            const Deadline &deadline = Deadline()) const {
+        return greedy(initialState, incumbent, deadline);
     }
     
 protected:
     // max recursion level in tree search
     unsigned int D_;
 
+    // number of threads used to evaluate root subtrees
+    unsigned int nThreads_;
+
     JZW ubSolver_;
 
     // tree search parameters
@@ -69,18 +160,37 @@ protected:
     // as in the article
     // side-effect: solBest if updated if necessary
     // (in the article, it is a global variable)
+    // root is the tree evaluated so far below state, or an empty node
     tuple<int, int, int> lookAheadAdvice(const BRPState &state,
-                                         shared_ptr<BRPState> &solBest) const;
+                                         GLAHIncumbent &solBest,
+                                         GLAHNode &root,
+                                         Deadline &deadline) const;
 
     // as in the article
     // side-effect: solBest if updated if necessary
     // (in the article, it is a global variable)
+    // rank is the index of the root subtree being explored
+    // node is the part of the tree already evaluated below state; it is
+    // extended and its costs are updated
+    // once deadline is reached, subtrees are no longer explored
     tuple<int, int, int> treeSearch(int d,
                                     const BRPState &state,
-                                    shared_ptr<BRPState> &solBest) const;
+                                    GLAHIncumbent &solBest,
+                                    int rank,
+                                    GLAHNode &node,
+                                    Deadline &deadline) const;
+
+    // cost of the subtree below each child of node, or -1 if it is pruned;
+    // subtrees are evaluated by nThreads_ threads
+    vector<int> evaluateRootsInParallel(const BRPState &state,
+                                        GLAHIncumbent &solBest,
+                                        GLAHNode &node,
+                                        Deadline &deadline) const;
 
-    // wrapped by solve()
-    shared_ptr<BRPState> greedy(const BRPState &initialState) const;
+    // wrapped by solve() and improve(); incumbent may be NULL
+    shared_ptr<BRPState> greedy(const BRPState &initialState,
+                                shared_ptr<BRPState> incumbent,
+                                const Deadline &deadline) const;
 
     // generate list of relocations for tree search
     vector<pair<int, int> > genReloList(const BRPState &state) const;
@@ -0,0 +1,114 @@
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <random>
+#include <cmath>
+
+#include "instancegen.h"
+
+int InstanceSpec::n() const {
+    return lround(fill * W * H);
+}
+
+// uniform integer in [0, k)
+// std::uniform_int_distribution differs between standard libraries
+static unsigned int draw(mt19937 &rng, unsigned int k) {
+    unsigned int limit = rng.max() - (rng.max() % k);
+    unsigned int x;
+    do {
+        x = rng();
+    } while ( x >= limit );
+    return x % k;
+}
+
+// std::shuffle differs between standard libraries too
+static void shuffleItems(vector<int> &items, mt19937 &rng) {
+    for (unsigned int i=items.size(); i > 1; i--) {
+        swap(items[i - 1], items[draw(rng, i)]);
+    }
+}
+
+// number of items in each stack
+static vector<int> stackHeights(const InstanceSpec &spec, mt19937 &rng) {
+    vector<int> heights(spec.W, 0);
+    if ( spec.distribution == "zehendner" ) {
+        // n / W items everywhere, the remaining ones in random stacks
+        vector<int> stacks;
+        for (int s=0; s < spec.W; s++) {
+            heights[s] = spec.n() / spec.W;
+            stacks.push_back(s);
+        }
+        shuffleItems(stacks, rng);
+        for (int i=0; i < spec.n() % spec.W; i++) {
+            heights[stacks[i]] += 1;
+        }
+    } else {
+        // each item goes to a random stack that is not full yet
+        vector<int> notFull;
+        for (int s=0; s < spec.W; s++) {
+            notFull.push_back(s);
+        }
+        for (int i=0; i < spec.n(); i++) {
+            int k = draw(rng, notFull.size());
+            int s = notFull[k];
+            heights[s] += 1;
+            if ( heights[s] == spec.H ) {
+                notFull[k] = notFull.back();
+                notFull.pop_back();
+            }
+        }
+    }
+    return heights;
+}
+
+vector<vector<int> > generateInstance(const InstanceSpec &spec) {
+    if ( spec.W < 1 || spec.H < 1 || spec.fill < 0 || spec.fill > 1 ) {
+        cerr << "invalid instance specification: W = " << spec.W
+             << ", H = " << spec.H << ", fill = " << spec.fill << endl;
+        exit(23);
+    }
+    if ( spec.distribution != "uniform" &&
+         spec.distribution != "zehendner" &&
+         spec.distribution != "manyblocking" ) {
+        cerr << "unknown instance distribution: " << spec.distribution
+             << endl;
+        exit(23);
+    }
+    mt19937 rng(spec.seed);
+    vector<int> heights = stackHeights(spec, rng);
+    vector<int> items;
+    for (int i=1; i <= spec.n(); i++) {
+        items.push_back(i);
+    }
+    shuffleItems(items, rng);
+    vector<vector<int> > stacks(spec.W);
+    auto it = items.begin();
+    for (int s=0; s < spec.W; s++) {
+        stacks[s].assign(it, it + heights[s]);
+        it += heights[s];
+        if ( spec.distribution == "manyblocking" ) {
+            sort(stacks[s].begin(), stacks[s].end());
+        }
+    }
+    return stacks;
+}
+
+void writeInstance(const vector<vector<int> > &stacks, string fName) {
+    int n = 0;
+    for (auto &stack: stacks) {
+        n += stack.size();
+    }
+    ofstream ofs(fName);
+    if ( ! ofs ) {
+        cerr << "cannot write instance to " << fName << endl;
+        exit(23);
+    }
+    ofs << stacks.size() << " " << n << endl;
+    for (auto &stack: stacks) {
+        ofs << stack.size();
+        for (auto item: stack) {
+            ofs << " " << item;
+        }
+        ofs << endl;
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef INSTANCEGEN_H
+#define INSTANCEGEN_H
+
+#include <vector>
+#include <string>
+
+using namespace std;
+
+// seeded random bays
+// the same specification always gives the same bay, on every platform
+struct InstanceSpec {
+    // number of stacks
+    int W = 10;
+    // number of tiers
+    int H = 6;
+    // n = fill * W * H items
+    double fill = 1.0;
+    // uniform: items in random slots, so stack heights vary
+    // zehendner: all stacks have the same height, within one item
+    // manyblocking: random slots, each stack holds its items in increasing
+    //   order from bottom to top, so everything above the bottom item blocks
+    string distribution = "uniform";
+    unsigned int seed = 0;
+
+    int n() const;
+};
+
+// stacks from bottom to top, items labelled 1..n, ready for the BRPState
+// constructor
+vector<vector<int> > generateInstance(const InstanceSpec &spec);
+
+// write stacks in the format of Caserta et al., as read by BRPState
+void writeInstance(const vector<vector<int> > &stacks, string fName);
+
+#endif
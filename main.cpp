@@ -1,30 +1,31 @@
 #include <iostream>
+#include <fstream>
 #include <vector>
 #include <string>
 #include <map>
 #include <iomanip>
+#include <chrono>
+#include <csignal>
 
 #include "brpstate.h"
 #include "branchandbound.h"
 #include "genpolicy.h"
+#include "counters.h"
+#include "instancegen.h"
+#include "batch.h"
+#include "service.h"
+#include "solutionsink.h"
+#include "yard.h"
+#include "dominance.h"
 
 using namespace std;
 
-// UB procedure for exact methods
-unique_ptr<BRPPolicy> ubSolver;
-// UB procedure for heuristic methods
-unique_ptr<BRPPolicy> hubSolver;
+// cancelled by SIGINT and SIGTERM when the search is saved to a checkpoint
+static const Deadline *interruptible = NULL;
 
-bool verbose;
-
-// for SmSEQC-X procedures
-string condensationProcedure = "tricoire";
-
-extern clock_t ticksInLB1;
-extern clock_t ticksInLB2;
-extern clock_t ticksInLB3;
-extern map<int, long long> countForGap;
-extern long long timeInLB1, timeInLB2, timeInLB3;
+static void interrupt(int) {
+    interruptible->cancel();
+}
 
 int main(int argc, char **argv) {
 
@@ -39,11 +40,40 @@ int main(int argc, char **argv) {
   string ubMethod = "LA-1";
   string hubMethod = "FM";
   string scriptFile = "";
+  // text, binary or json
+  string scriptFormat = "text";
   int LB = 1;
-  // string condensationProcedure = "none";
-  verbose = false;
+  // for SmSEQC-X procedures
+  string condensationProcedure = "tricoire";
+  bool verbose = false;
   bool debug = false;
   int timeLimit = 0;
+  unsigned int nThreads = 1;
+  // table, json or empty for no statistics
+  string statsFormat = "";
+  // generated instance, used instead of -i when the distribution is set
+  InstanceSpec genSpec;
+  genSpec.distribution = "";
+  string genOutFile = "";
+  // instances to solve in batch mode
+  string batchSource = "";
+  // archive the batch instances are converted to, instead of solving them
+  string packFile = "";
+  // service mode: requests from stdin, or from a Unix socket
+  bool serve = false;
+  string socketPath = "";
+  string clientSocketPath = "";
+  // DFBB searches stopped by -tl or a signal are saved there, and resumed
+  string checkpointFile = "";
+  // multi-bay instance, solved bay by bay
+  string yardFile = "";
+  // dominance rules of the exact methods
+  string dominanceSpec = "all";
+  // restricted or unrestricted BRP, for the exact methods
+  string variant = "unrestricted";
+  // heuristic DFBB dives from some of its nodes, and which nodes
+  string diveMethod = "";
+  string diveSchedule = "adaptive";
   
   int i = 1;
   while (i<argc){
@@ -80,6 +110,86 @@ int main(int argc, char **argv) {
       i++;
       timeLimit = atoi(argv[i]);
       i++;
+    } else if (tmp == "-threads") {
+      i++;
+      nThreads = atoi(argv[i]);
+      i++;
+    } else if (tmp == "-gen") {
+      i++;
+      genSpec.distribution = argv[i];
+      i++;
+    } else if (tmp == "-W") {
+      i++;
+      genSpec.W = atoi(argv[i]);
+      i++;
+    } else if (tmp == "-H") {
+      i++;
+      genSpec.H = atoi(argv[i]);
+      i++;
+    } else if (tmp == "-fill") {
+      i++;
+      genSpec.fill = atof(argv[i]);
+      i++;
+    } else if (tmp == "-seed") {
+      i++;
+      seed = atoi(argv[i]);
+      i++;
+    } else if (tmp == "-gen-out") {
+      i++;
+      genOutFile = argv[i];
+      i++;
+    } else if (tmp == "-batch") {
+      i++;
+      batchSource = argv[i];
+      i++;
+    } else if (tmp == "-sf-format") {
+      i++;
+      scriptFormat = argv[i];
+      i++;
+    } else if (tmp == "-pack") {
+      i++;
+      packFile = argv[i];
+      i++;
+    } else if (tmp == "-serve") {
+      i++;
+      serve = true;
+    } else if (tmp == "-socket") {
+      i++;
+      socketPath = argv[i];
+      serve = true;
+      i++;
+    } else if (tmp == "-client") {
+      i++;
+      clientSocketPath = argv[i];
+      i++;
+    } else if (tmp == "-yard") {
+      i++;
+      yardFile = argv[i];
+      i++;
+    } else if (tmp == "-dominance") {
+      i++;
+      dominanceSpec = argv[i];
+      i++;
+    } else if (tmp == "-variant") {
+      i++;
+      variant = argv[i];
+      i++;
+    } else if (tmp == "-dive") {
+      i++;
+      diveMethod = argv[i];
+      i++;
+    } else if (tmp == "-dive-at") {
+      i++;
+      diveSchedule = argv[i];
+      i++;
+    } else if (tmp == "-checkpoint") {
+      i++;
+      checkpointFile = argv[i];
+      i++;
+    } else if (tmp == "-stats") {
+      i++;
+      statsFormat = argv[i];
+      i++;
     } else if (tmp == "-cp") {
       i++;
       condensationProcedure = argv[i];
@@ -100,6 +210,168 @@ int main(int argc, char **argv) {
     }
   }
 
+  if ( statsFormat != "" && statsFormat != "table" && statsFormat != "json" ) {
+      cerr << "unknown statistics format: " << statsFormat << endl;
+      exit(6);
+  }
+  unsigned int dominanceRules;
+  if ( ! parseDominanceRules(dominanceSpec, dominanceRules) ) {
+      cerr << "unknown dominance rules: " << dominanceSpec << endl;
+      exit(5);
+  }
+  if ( variant != "restricted" && variant != "unrestricted" ) {
+      cerr << "unknown BRP variant: " << variant << endl;
+      exit(5);
+  }
+  bool restricted = variant == "restricted";
+  if ( diveMethod != "" && ! validPolicyName(diveMethod, true) ) {
+      cerr << "unknown dive method: " << diveMethod << endl;
+      exit(5);
+  }
+  DiveSchedule schedule;
+  int diveParam;
+  if ( ! parseDiveSchedule(diveSchedule, schedule, diveParam) ) {
+      cerr << "unknown dive schedule: " << diveSchedule << endl;
+      exit(5);
+  }
+  if ( checkpointFile != "" &&
+       ( method != "DFBB" || serve || batchSource != "" ) ) {
+      cerr << "-checkpoint only applies to -m DFBB on a single instance"
+           << endl;
+      exit(5);
+  }
+  if ( ! validSolutionFormat(scriptFormat) ) {
+      cerr << "unknown solution format: " << scriptFormat << endl;
+      exit(6);
+  }
+  if ( yardFile != "" && ( serve || batchSource != "" ||
+                           scriptFormat != "text" ) ) {
+      cerr << "-yard does not apply with -serve, -batch or -sf-format"
+           << endl;
+      exit(5);
+  }
+  // generate an instance and only write it
+  genSpec.seed = seed;
+  if ( genSpec.distribution != "" && genOutFile != "" ) {
+      writeInstance(generateInstance(genSpec), genOutFile);
+      return 0;
+  }
+
+  if ( clientSocketPath != "" ) {
+      runClient(clientSocketPath, cin, cout);
+      return 0;
+  }
+
+  // service mode: no banner, one json line per request
+  if ( serve ) {
+      srandom(seed);
+      ServiceSettings settings;
+      settings.context = makeSolverContext(ubMethod, hubMethod,
+                                           condensationProcedure, verbose,
+                                           true, dominanceRules,
+                                           restricted, diveMethod,
+                                           diveSchedule);
+      settings.lbVersion = LB;
+      settings.method = method;
+      settings.timeLimit = timeLimit;
+      settings.maxHeightType = maxHeightType;
+      settings.bbStrategy = bbStrategy;
+      settings.nThreads = nThreads;
+      if ( socketPath != "" ) {
+          serveSocket(socketPath, settings);
+      } else {
+          serveStream(cin, cout, settings);
+      }
+      return 0;
+  }
+
+  if ( packFile != "" ) {
+      if ( batchSource == "" ) {
+          cerr << "-pack needs the instances given with -batch" << endl;
+          exit(5);
+      }
+      writeArchive(listInstances(batchSource), packFile);
+      return 0;
+  }
+
+  // solutions of all instances go there, written when it is destroyed;
+  // created only now, as it truncates the file and the modes above never
+  // write to it
+  unique_ptr<SolutionSink> solutions;
+  if ( scriptFile != "" && yardFile == "" ) {
+      solutions = makeSolutionSink(scriptFormat, scriptFile);
+  }
+
+  // batch mode: no banner, one json line per instance
+  if ( batchSource != "" ) {
+      srandom(seed);
+      BatchSettings settings;
+      settings.context = makeSolverContext(ubMethod, hubMethod,
+                                           condensationProcedure, verbose,
+                                           true, dominanceRules,
+                                           restricted, diveMethod,
+                                           diveSchedule);
+      settings.lbVersion = LB;
+      settings.method = method;
+      settings.maxHeightType = maxHeightType;
+      settings.bbStrategy = bbStrategy;
+      settings.timeLimit = timeLimit;
+      settings.nThreads = nThreads;
+      settings.solutions = solutions.get();
+      if ( InstanceArchive::isArchive(batchSource) ) {
+          solveBatch(InstanceArchive(batchSource), settings, cout);
+      } else {
+          solveBatch(listInstances(batchSource), settings, cout);
+      }
+      if ( statsFormat != "" ) {
+          Counters::print(cout, statsFormat);
+      }
+      return 0;
+  }
+
+  // yard mode: one json line per bay, then one for the yard
+  if ( yardFile != "" ) {
+      srandom(seed);
+      YardSettings settings;
+      settings.context = makeSolverContext(ubMethod, hubMethod,
+                                           condensationProcedure, verbose,
+                                           true, dominanceRules,
+                                           restricted, diveMethod,
+                                           diveSchedule);
+      settings.lbVersion = LB;
+      settings.method = method;
+      settings.maxHeightType = maxHeightType;
+      settings.bbStrategy = bbStrategy;
+      settings.timeLimit = timeLimit;
+      settings.nThreads = nThreads;
+      Yard yard = readYard(yardFile);
+      auto timeBefore = chrono::steady_clock::now();
+      YardPlan plan = solveYard(yard, settings);
+      double time = chrono::duration<double>(
+          chrono::steady_clock::now() - timeBefore).count();
+      for (int b=0; b < plan.bays.size(); b++) {
+          const BaySolution &bay = plan.bays[b];
+          cout << "{\"bay\": " << b << ", "
+               << "\"relocations\": " << bay.solution->nRelocations() << ", "
+               << "\"time\": " << bay.time << ", "
+               << "\"status\": \"" << bay.status << "\"}" << endl;
+      }
+      cout << "{\"yard\": \"" << yardFile << "\", "
+           << "\"method\": \"" << method << "\", "
+           << "\"bays\": " << yard.bays.size() << ", "
+           << "\"items\": " << yard.n << ", "
+           << "\"relocations\": " << plan.nRelocations << ", "
+           << "\"time\": " << time << "}" << endl;
+      if ( scriptFile != "" ) {
+          ofstream ofs(scriptFile);
+          writeYardPlan(ofs, plan);
+      }
+      if ( statsFormat != "" ) {
+          Counters::print(cout, statsFormat);
+      }
+      return 0;
+  }
+
   // dump parameter settings
   cout << "-----------------------------------------------------------" << endl;
   cout << "Parameter settings" << endl;
@@ -110,44 +382,63 @@ int main(int argc, char **argv) {
   cout << "UB method:\t\t\t" << ubMethod << endl; 
   cout << "UB method for heuristics:\t" << hubMethod << endl;
   cout << "condensation procedure:\t\t" << condensationProcedure << endl;
-  cout << "Instance file:\t\t\t" << instanceFname << endl;
+  cout << "dominance rules:\t\t" << dominanceSpec << endl;
+  cout << "BRP variant:\t\t\t" << variant << endl;
+  cout << "DFBB dives:\t\t\t"
+       << (diveMethod == "" ? "none" : diveMethod + " at " + diveSchedule)
+       << endl;
+  if ( genSpec.distribution != "" ) {
+      cout << "Generated instance:\t\t" << genSpec.distribution
+           << " W=" << genSpec.W << " H=" << genSpec.H
+           << " fill=" << genSpec.fill << " seed=" << seed << endl;
+  } else {
+      cout << "Instance file:\t\t\t" << instanceFname << endl;
+  }
   cout << "max. height:\t\t\t" << maxHeightType << endl;
   cout << "Time limit:\t\t\t" << timeLimit << endl;
+  cout << "Threads:\t\t\t" << nThreads << endl;
   cout << "script file:\t\t\t" << scriptFile << endl;
   cout << "-----------------------------------------------------------" << endl;
   
-  const BRPState s(instanceFname, maxHeightType);
+  BRPState s = genSpec.distribution != "" ?
+      BRPState(generateInstance(genSpec), maxHeightType) :
+      BRPState(instanceFname, maxHeightType);
+  s.setLBVersion(LB);
   if ( verbose ) {
       cout << s << endl;
   }
 
-  if ( scriptFile != "" ) {
-      s.writeInstanceToFile(scriptFile);
-  }
-
   // cout << "LB1 = " << s.LB1() << endl;
   // cout << "LB2 = " << s.LB2() << endl;
   // cout << "LB3 = " << s.LB3() << endl;
   
   cout << "initialising random number generator: srandom(" << seed << ");\n";
   srandom(seed);
-  //
-  BRPState::lbVersion = LB;
-  // method used for UB calculation
-  ubSolver = genPolicy(ubMethod, s, timeLimit, bbStrategy, true);
-  hubSolver = genPolicy(hubMethod, s, timeLimit, bbStrategy, true);
+  // methods used for UB calculation
+  auto context = makeSolverContext(ubMethod, hubMethod, condensationProcedure,
+                                   verbose, false, dominanceRules,
+                                   restricted, diveMethod, diveSchedule);
   //
   // main solver we use
-  auto solver = genPolicy(method, s, timeLimit, bbStrategy);
-  clock_t ticksBefore = clock();
-  shared_ptr<BRPState> result = solver->solve(s);
-  clock_t ticksAfter = clock();
+  auto solver = genPolicy(method, context, timeLimit, bbStrategy, false,
+                          nThreads);
+  Deadline deadline(timeLimit);
+  if ( checkpointFile != "" ) {
+      static_cast<DFBB &>(*solver).setCheckpoint(checkpointFile);
+      interruptible = &deadline;
+      signal(SIGINT, interrupt);
+      signal(SIGTERM, interrupt);
+  }
+  auto timeBefore = chrono::steady_clock::now();
+  shared_ptr<BRPState> result = solver->solve(s, deadline);
+  auto timeAfter = chrono::steady_clock::now();
   cout << method << "\t used " << result->nRelocations() << " relocations in "
-       << ( (double) (ticksAfter - ticksBefore) / CLOCKS_PER_SEC)
+       << chrono::duration<double>(timeAfter - timeBefore).count()
        << " s" << endl;
   
-  if ( scriptFile != "" ) { 
-      result->appendSolutionToFile(scriptFile);
+  if ( solutions != NULL ) {
+      solutions->write(genSpec.distribution != "" ? "generated" :
+                       instanceFname, s, *result);
   }
   
   if ( verbose ) {
@@ -155,25 +446,24 @@ int main(int argc, char **argv) {
   }
 
   if (LB == -1) {
-      cout << "Time spent in LB1: " << ((double)ticksInLB1) / CLOCKS_PER_SEC
-           << endl;
-      cout << "Time spent in LB2: " << ((double)ticksInLB2) / CLOCKS_PER_SEC
-           << endl;
-      cout << "Time spent in LB3: " << ((double)ticksInLB3) / CLOCKS_PER_SEC
-           << endl;
-      cout << "/!\\ IMPORTANT NOTE: times are inaccurate"
-           << " since a single call typically takes less than one tick"
-           << endl;
       long long  nNodes = 0;
-      for (auto it=countForGap.begin(); it != countForGap.end(); it++) {
-          nNodes += it->second;
+      for (int gap=0; gap < Counters::gapBuckets; gap++) {
+          nNodes += Counters::total(Counters::Id(Counters::lbGap + gap));
       }
       cout << nNodes << " nodes" << endl;
       cout.setf(ios::fixed);
       cout.precision(2);
-      for (auto it=countForGap.begin(); it != countForGap.end(); it++) {
-          cout << "gap = " << it->first << " :\t" << it->second << " nodes\t-\t"
-               << 100.0 * it->second / nNodes << " %" << endl;
+      for (int gap=0; gap < Counters::gapBuckets && nNodes > 0; gap++) {
+          long long count =
+              Counters::total(Counters::Id(Counters::lbGap + gap));
+          cout << "gap = " << gap
+               << (gap == Counters::gapBuckets - 1 ? "+" : "") << " :\t"
+               << count << " nodes\t-\t"
+               << 100.0 * count / nNodes << " %" << endl;
       }
   }
+
+  if ( statsFormat != "" ) {
+      Counters::print(cout, statsFormat);
+  }
 }
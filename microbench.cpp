@@ -0,0 +1,403 @@
+// micro-benchmarks for the BRPState primitives
+// every primitive is timed in ns/op on seeded random bays of several shapes;
+// cycles and instructions per operation are added when the kernel lets us
+// read the hardware counters
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <functional>
+
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "brpstate.h"
+
+using namespace std;
+
+// results are accumulated here so that calls cannot be optimised away
+volatile long long sink;
+
+// cycles and instructions of the calling thread, if available
+class HardwareCounters {
+public:
+    HardwareCounters() {
+        cycles_ = open(PERF_COUNT_HW_CPU_CYCLES, -1);
+        instructions_ = open(PERF_COUNT_HW_INSTRUCTIONS, cycles_);
+        if ( cycles_ < 0 || instructions_ < 0 ) {
+            close();
+        }
+    }
+
+    ~HardwareCounters() { close(); }
+
+    bool available() const { return cycles_ >= 0; }
+
+    // counts are only accumulated between enable() and disable()
+    void reset() {
+        if ( available() ) {
+            ioctl(cycles_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        }
+    }
+
+    void enable() {
+        if ( available() ) {
+            ioctl(cycles_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+    }
+
+    void disable() {
+        if ( available() ) {
+            ioctl(cycles_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        }
+    }
+
+    // <cycles, instructions> since reset()
+    pair<long long, long long> read() const {
+        if ( ! available() ) {
+            return make_pair(0, 0);
+        }
+        long long cycles = 0, instructions = 0;
+        if ( ::read(cycles_, &cycles, sizeof(cycles)) != sizeof(cycles) ||
+             ::read(instructions_, &instructions, sizeof(instructions))
+             != sizeof(instructions) ) {
+            return make_pair(0, 0);
+        }
+        return make_pair(cycles, instructions);
+    }
+
+protected:
+    int open(unsigned long long config, int groupLeader) {
+        struct perf_event_attr attr;
+        fill((char *) &attr, (char *) &attr + sizeof(attr), 0);
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = config;
+        attr.disabled = groupLeader < 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        return syscall(__NR_perf_event_open, &attr, 0, -1, groupLeader, 0);
+    }
+
+    void close() {
+        if ( instructions_ >= 0 ) {
+            ::close(instructions_);
+        }
+        if ( cycles_ >= 0 ) {
+            ::close(cycles_);
+        }
+        cycles_ = instructions_ = -1;
+    }
+
+    int cycles_;
+    int instructions_;
+};
+
+struct Shape {
+    int W;
+    int H;
+    int n;
+};
+
+// n items spread at random over W stacks, at most H high
+vector<vector<int> > randomBay(const Shape &shape, mt19937 &rng) {
+    vector<int> items;
+    for (int i=1; i <= shape.n; i++) {
+        items.push_back(i);
+    }
+    shuffle(items.begin(), items.end(), rng);
+    vector<vector<int> > stacks(shape.W);
+    uniform_int_distribution<int> anyStack(0, shape.W - 1);
+    for (auto item: items) {
+        int s = anyStack(rng);
+        while ( stacks[s].size() >= shape.H ) {
+            s = (s + 1) % shape.W;
+        }
+        stacks[s].push_back(item);
+    }
+    return stacks;
+}
+
+// same, but every stack is sorted so that all items can be retrieved
+// without any relocation
+vector<vector<int> > sortedBay(const Shape &shape, mt19937 &rng) {
+    auto stacks = randomBay(shape, rng);
+    for (auto &stack: stacks) {
+        sort(stack.rbegin(), stack.rend());
+    }
+    return stacks;
+}
+
+// random relocation between two different stacks
+pair<int, int> randomRelocation(const BRPState &state, mt19937 &rng) {
+    uniform_int_distribution<int> anyStack(0, state.W() - 1);
+    int from, to;
+    do {
+        from = anyStack(rng);
+    } while ( state.height(from) == 0 );
+    do {
+        to = anyStack(rng);
+    } while ( to == from || state.height(to) >= state.H() );
+    return make_pair(from, to);
+}
+
+// states met along a random walk from a random bay
+vector<BRPState> sampleStates(const Shape &shape, mt19937 &rng,
+                              int nSamples) {
+    BRPState state(randomBay(shape, rng), "H+2");
+    vector<BRPState> samples;
+    while ( samples.size() < nSamples ) {
+        while ( state.retrieveNext() );
+        if ( state.empty() ) {
+            state = BRPState(randomBay(shape, rng), "H+2");
+            continue;
+        }
+        samples.push_back(state);
+        // relocate a blocking item, as most algorithms would
+        int from = state.stackForItem(state.next());
+        uniform_int_distribution<int> anyStack(0, state.W() - 1);
+        int to;
+        do {
+            to = anyStack(rng);
+        } while ( to == from || state.height(to) >= state.H() );
+        state.relocate(from, to);
+    }
+    return samples;
+}
+
+double secondsSince(chrono::steady_clock::time_point before) {
+    return chrono::duration<double>(chrono::steady_clock::now() - before)
+        .count();
+}
+
+// the part of a body that is measured, by the wall clock and by the
+// hardware counters alike
+class Span {
+public:
+    Span(HardwareCounters &hw) : hw_(hw), elapsed_(0) { }
+
+    void start() {
+        hw_.enable();
+        before_ = chrono::steady_clock::now();
+    }
+
+    void stop() {
+        elapsed_ += secondsSince(before_);
+        hw_.disable();
+    }
+
+    // seconds between every start() and the following stop()
+    double elapsed() const { return elapsed_; }
+
+protected:
+    HardwareCounters &hw_;
+    chrono::steady_clock::time_point before_;
+    double elapsed_;
+};
+
+class MicroBench {
+public:
+    MicroBench(double minTime) : minTime_(minTime) { }
+
+    // body performs nOps operations between span.start() and span.stop(),
+    // so that it can leave its set-up out; it is repeated until minTime_
+    // seconds have been measured
+    void run(string primitive, const Shape &shape,
+             function<void(long long &nOps, Span &span)> body) {
+        long long nOps = 0;
+        Span span(hw_);
+        hw_.reset();
+        while ( span.elapsed() < minTime_ ) {
+            body(nOps, span);
+        }
+        auto counters = hw_.read();
+        stringstream shapeName;
+        shapeName << shape.W << "x" << shape.H << " n=" << shape.n;
+        cout << left << setw(20) << primitive << setw(18) << shapeName.str()
+             << right << fixed << setprecision(1)
+             << setw(12) << 1e9 * span.elapsed() / nOps;
+        if ( hw_.available() ) {
+            cout << setw(12) << (double) counters.first / nOps
+                 << setw(12) << (double) counters.second / nOps;
+        } else {
+            cout << setw(12) << "n/a" << setw(12) << "n/a";
+        }
+        cout << endl;
+    }
+
+    bool hardwareCounters() const { return hw_.available(); }
+
+protected:
+    double minTime_;
+    HardwareCounters hw_;
+};
+
+void benchShape(MicroBench &bench, const Shape &shape, unsigned int seed) {
+    mt19937 rng(seed);
+    const int nSamples = 64;
+    vector<BRPState> samples = sampleStates(shape, rng, nSamples);
+    // sequences of legal relocations, one per sample
+    const int walkLength = 256;
+    vector<vector<pair<int, int> > > walks;
+    for (auto sample: samples) {
+        vector<pair<int, int> > walk;
+        for (int i=0; i < walkLength; i++) {
+            walk.push_back(randomRelocation(sample, rng));
+            sample.relocate(walk.back().first, walk.back().second);
+        }
+        walks.push_back(walk);
+    }
+    vector<BRPState> sorted;
+    for (int i=0; i < nSamples; i++) {
+        sorted.push_back(BRPState(sortedBay(shape, rng), "H+2"));
+    }
+    int current = 0;
+    auto nextSample = [&]() {
+        current = (current + 1) % nSamples;
+        return current;
+    };
+
+    bench.run("copy", shape, [&](long long &nOps, Span &span) {
+            span.start();
+            for (int i=0; i < nSamples; i++) {
+                BRPState copy(samples[i]);
+                sink += copy.n();
+            }
+            span.stop();
+            nOps += nSamples;
+        });
+    bench.run("relocate", shape, [&](long long &nOps, Span &span) {
+            int i = nextSample();
+            BRPState state(samples[i]);
+            span.start();
+            for (auto move: walks[i]) {
+                state.relocate(move.first, move.second);
+            }
+            span.stop();
+            nOps += walkLength;
+        });
+    bench.run("undoLastMove", shape, [&](long long &nOps, Span &span) {
+            int i = nextSample();
+            BRPState state(samples[i]);
+            for (auto move: walks[i]) {
+                state.relocate(move.first, move.second);
+            }
+            span.start();
+            for (int j=0; j < walkLength; j++) {
+                state.undoLastMove();
+            }
+            span.stop();
+            nOps += walkLength;
+        });
+    bench.run("pop", shape, [&](long long &nOps, Span &span) {
+            BRPState state(sorted[nextSample()]);
+            span.start();
+            for (int item=1; item <= shape.n; item++) {
+                sink += state.pop(state.stackForItem(item));
+            }
+            span.stop();
+            nOps += shape.n;
+        });
+    bench.run("retrieveNext", shape, [&](long long &nOps, Span &span) {
+            BRPState state(sorted[nextSample()]);
+            span.start();
+            while ( state.retrieveNext() ) {
+                nOps += 1;
+            }
+            span.stop();
+        });
+    // const queries, on every sample in turn
+    vector<pair<string, function<long long(const BRPState &)> > > queries = {
+        { "LB1", [](const BRPState &s) { return s.LB1(); } },
+        { "LB2", [](const BRPState &s) { return s.LB2(); } },
+        { "LB3", [](const BRPState &s) { return s.LB3(); } },
+        { "necessaryRelocates", [](const BRPState &s) {
+                return s.necessaryRelocates()->size(); } },
+        { "bestSafeRelocate", [](const BRPState &s) {
+                return get<2>(s.bestSafeRelocate()); } },
+        { "safe2Relocates", [](const BRPState &s) {
+                return s.safe2Relocates()->size(); } },
+        { "nonFullStackFrom", [](const BRPState &s) {
+                return s.nonFullStackFrom(s.n() / 2); } },
+        { "badTopUpTo", [](const BRPState &s) {
+                return s.badTopUpTo(1, s.n()); } }
+    };
+    for (auto &query: queries) {
+        bench.run(query.first, shape, [&](long long &nOps, Span &span) {
+                span.start();
+                for (auto &sample: samples) {
+                    sink += query.second(sample);
+                }
+                span.stop();
+                nOps += nSamples;
+            });
+    }
+}
+
+// W:H:n,W:H:n,...
+vector<Shape> parseShapes(string list) {
+    vector<Shape> shapes;
+    stringstream ss(list);
+    string item;
+    while ( getline(ss, item, ',') ) {
+        Shape shape;
+        char c1, c2;
+        stringstream is(item);
+        if ( ! (is >> shape.W >> c1 >> shape.H >> c2 >> shape.n) ||
+             c1 != ':' || c2 != ':' || shape.n > shape.W * shape.H ||
+             2 * shape.W < shape.H + 2 ) {
+            // with a max. height of H+2, 2W >= H+2 guarantees that there
+            // is always a stack to relocate to
+            cerr << "invalid shape: " << item << " (expected W:H:n with "
+                 << "n <= W*H and 2W >= H+2)" << endl;
+            exit(5);
+        }
+        shapes.push_back(shape);
+    }
+    return shapes;
+}
+
+int main(int argc, char **argv) {
+    string shapeList = "6:4:16,10:6:40,20:8:120,40:10:300";
+    unsigned int seed = 0;
+    double minTime = 0.2;
+
+    int i = 1;
+    while (i < argc) {
+        string tmp = argv[i];
+        if ( i + 1 >= argc ) {
+            cerr << "missing value for option: " << tmp << endl;
+            exit(5);
+        }
+        if (tmp == "-shapes") {
+            shapeList = argv[i+1];
+        } else if (tmp == "-seed") {
+            seed = atoi(argv[i+1]);
+        } else if (tmp == "-mintime") {
+            minTime = atof(argv[i+1]);
+        } else {
+            cerr << "unrecognized option: " << tmp << endl;
+            exit(5);
+        }
+        i += 2;
+    }
+
+    MicroBench bench(minTime);
+    if ( ! bench.hardwareCounters() ) {
+        cout << "hardware counters are not available "
+             << "(see /proc/sys/kernel/perf_event_paranoid)" << endl;
+    }
+    cout << left << setw(20) << "primitive" << setw(18) << "shape"
+         << right << setw(12) << "ns/op" << setw(12) << "cycles/op"
+         << setw(12) << "instr/op" << endl;
+    for (auto shape: parseShapes(shapeList)) {
+        benchShape(bench, shape, seed);
+    }
+}
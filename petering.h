@@ -9,7 +9,16 @@ public:
     LA_N() { }
     LA_N(unsigned int N) { N_ = N; }
 
-    virtual string name() const { return "LA_N(" + to_string(N_) + ")"; }
+    // LA-S-1: N is the number of stacks minus one, whatever the bay
+    static unique_ptr<LA_N> allButOneStack() {
+        auto result = make_unique<LA_N>(0);
+        result->allButOneStack_ = true;
+        return result;
+    }
+
+    virtual string name() const {
+        return allButOneStack_ ? "LA_N(W-1)" : "LA_N(" + to_string(N_) + ")";
+    }
     
 protected:
     // name of this policy
@@ -17,6 +26,8 @@ protected:
     
     unsigned int N_;
 
+    bool allButOneStack_ = false;
+
     virtual bool voluntaryMoves(BRPState &s) const;
 };
 
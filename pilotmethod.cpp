@@ -4,21 +4,26 @@
 #include "brppolicy.h"
 #include "safemoves.h"
 #include "subsequence.h"
+#include "counters.h"
 
-extern unique_ptr<BRPPolicy> hubSolver;
-extern bool verbose;
 
-shared_ptr<BRPState> PilotMethod::solve(const BRPState &s1) const {
-    cout << "Solving with " << name() << endl;
+shared_ptr<BRPState> PilotMethod::solve(const BRPState &s1,
+                                        const Deadline &callerDeadline) const {
+    // polled at every successor
+    Deadline deadline(callerDeadline);
+    log() << "Solving with " << name() << endl;
     BRPState state(s1);
     vector<shared_ptr<BRPState> > Q;
     shared_ptr<BRPState> bestKnown = NULL;
-    UB(s1, bestKnown);
+    UB(s1, bestKnown, deadline);
     Q.push_back(make_shared<BRPState>(state));
     while (true) {
-        if ( verbose ) {
-            cout << "Size of Q: " << Q.size() << endl;
-            cout << "\tBest solution found so far: "
+        if ( deadline.reached() ) {
+            return bestKnown;
+        }
+        if ( context().verbose ) {
+            log() << "Size of Q: " << Q.size() << endl;
+            log() << "\tBest solution found so far: "
                  << bestKnown->nRelocations()
                  << endl;
         }
@@ -26,11 +31,13 @@ shared_ptr<BRPState> PilotMethod::solve(const BRPState &s1) const {
         vector<shared_ptr<BRPState> > bestCandidates;
             unsigned int nSucc = 0;
         for (auto cs: Q) {
+            COUNT(nodes);
             // cout << "\t\tstate with NR = " << cs->nRelocations()
             //      << ", LB = " << cs->LB3() << endl;
 
             if (cs->nRelocations() + cs->LB3() >= bestKnown->nRelocations()) {
                 // cout << "\t\t --> Skipping!!!!!!!!!!!!!!!!!!!!!!!!!!" << endl;
+                COUNT(prunedByBound);
                 continue;
             }
             
@@ -45,6 +52,9 @@ shared_ptr<BRPState> PilotMethod::solve(const BRPState &s1) const {
             }
             // step 2: try each successor
             for ( auto move: genSuccMoves(*cs) ) {
+                if ( deadline.poll() ) {
+                    return bestKnown;
+                }
                 nSucc += 1;
                 shared_ptr<BRPState> succ = make_shared<BRPState>(*cs);
                 succ->relocate(move.first, move.second);
@@ -52,7 +62,7 @@ shared_ptr<BRPState> PilotMethod::solve(const BRPState &s1) const {
                 voluntaryMoves(*succ);
                 
                 // unsigned int lb = succ->LB();
-                unsigned int ub = UB(*succ, bestKnown);
+                unsigned int ub = UB(*succ, bestKnown, deadline);
                 // we only keep the best
                 if ( ub < bestUB ) {
                     bestUB = ub;
@@ -89,13 +99,15 @@ shared_ptr<BRPState> PilotMethod::solve(const BRPState &s1) const {
             }
         }
     }
-    cout << "tralala" << endl;
+    log() << "tralala" << endl;
     return NULL;
 }
                                                         
 unsigned int PilotMethod::UB(const BRPState &state,
-                             shared_ptr<BRPState> &bestKnown) const {
-    auto thisResult = hubSolver->solve(state);
+                             shared_ptr<BRPState> &bestKnown,
+                             const Deadline &deadline) const {
+    COUNT(heuristicRollouts);
+    auto thisResult = context().hubSolver->solve(state, deadline);
     if ( bestKnown == NULL ||
          thisResult->nRelocations() < bestKnown->nRelocations() ) {
         bestKnown = thisResult;
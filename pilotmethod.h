@@ -8,13 +8,16 @@ public:
     PilotMethod(unsigned int width=10) { width_ = width; }
 
     // return number of moves necessary to empty the bay
-    virtual shared_ptr<BRPState> solve(const BRPState &s1) const;
+    virtual shared_ptr<BRPState>
+    solve(const BRPState &s1,
+          const Deadline &deadline = Deadline()) const;
                                                         
     string name() const { return "pilot method"; }
     
 protected:
     unsigned int UB(const BRPState &state,
-                    shared_ptr<BRPState> &bestKnown) const;
+                    shared_ptr<BRPState> &bestKnown,
+                    const Deadline &deadline) const;
     virtual vector<pair<int, int> > genSuccMoves(BRPState &state) const;
 
     unsigned int width_;
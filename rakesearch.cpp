@@ -1,24 +1,31 @@
 #include "fastmeta.h"
 #include "rakesearch.h"
 #include "subsequence.h"
+#include "counters.h"
 
 
 // return number of moves necessary to empty the bay
-shared_ptr<BRPState> RakeSearch::solve(const BRPState &s1) const {
+shared_ptr<BRPState> RakeSearch::solve(const BRPState &s1,
+                                       const Deadline &callerDeadline) const {
+    // polled at every node of the tree
+    Deadline deadline(callerDeadline);
     // cout << "Solving with " << name() << endl;
     BRPState state(s1);
     deque<shared_ptr<BRPState> > Q;
     Q.push_back(make_shared<BRPState>(state));
-    while (Q.size() < width_) {
+    // out of time: stop growing the tree and finish what we have
+    while (Q.size() < width_ && ! deadline.reached()) {
+        COUNT_MAX(peakOpen, Q.size());
         // cout << "Q.size() = " << Q.size() << endl;
         // we want to process the whole content of Q at once to generate the
         // next tree level
         unsigned int nRemaining = Q.size();
-        while (nRemaining > 0) {
+        while (nRemaining > 0 && ! deadline.poll()) {
             // retrieve next (current) state to process
             auto cs = Q.front();
             Q.pop_front();
             --nRemaining;
+            COUNT(nodes);
             // step 1: retrieve all items that can be retrieved
             while ( cs->next() <= cs->n() &&
                     cs->next() == cs->top(cs->stackForItem(cs->next()) ) ) {
@@ -46,12 +53,16 @@ shared_ptr<BRPState> RakeSearch::solve(const BRPState &s1) const {
     
     // at this point, we have generated enough partial solutions
     // now we finish them with heuristics
-    FastMetaPolicy fm;
     shared_ptr<BRPState> best = NULL;
     // cout << "Done with the tree, applying " << heuristics.size()
     //      << " heuristics to " << Q.size() << " partial solutions" << endl;
     for (auto thisState: Q) {
-        auto thisResult = fm.solve(*thisState);
+        // out of time: only finish the first partial solution
+        if ( best != NULL && deadline.reached() ) {
+            break;
+        }
+        COUNT(heuristicRollouts);
+        auto thisResult = finisher_.solve(*thisState, deadline);
         if ( best == NULL ||
              thisResult->nRelocations() < best->nRelocations() ) {
             // cout << "new best: " << thisResult << endl;
@@ -69,8 +80,10 @@ void RakeSearch::updateQueue(deque<shared_ptr<BRPState> > &Q,
     //      << state->nRelocations() + state->LB() << endl;
     unsigned int i = startPosition;
     while (i < Q.size()) {
+        COUNT(ttProbes);
         if ( Q[i]->dominates(*state) ) {
             // cout << "\tdominated!" << endl;
+            COUNT(prunedDominated);
             return;
         } else if ( state->dominates(*Q[i]) ) {
             // cout << "\tnew solution dominates old one!" << endl;
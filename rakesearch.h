@@ -4,19 +4,30 @@
 #include <deque>
 
 #include "safemoves.h"
+#include "fastmeta.h"
 
 class RakeSearch: public SafeMovesPolicy {
 public:
     RakeSearch(unsigned int width=50) { width_ = width; }
 
     // return number of moves necessary to empty the bay
-    virtual shared_ptr<BRPState> solve(const BRPState &s1) const;
+    virtual shared_ptr<BRPState>
+    solve(const BRPState &s1,
+          const Deadline &deadline = Deadline()) const;
                                                         
     string name() const { return "rake search"; }
+
+    virtual void setContext(shared_ptr<const SolverContext> context) {
+        SafeMovesPolicy::setContext(context);
+        finisher_.setContext(context);
+    }
     
 protected:
     unsigned int width_;
 
+    // used to finish partial solutions
+    FastMetaPolicy finisher_;
+
     void updateQueue(deque<shared_ptr<BRPState> > &Q,
                      unsigned int startPosition,
                      shared_ptr<BRPState> state) const;
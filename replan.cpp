@@ -0,0 +1,123 @@
+#include <algorithm>
+
+#include "replan.h"
+
+bool applyDelta(const vector<vector<int> > &stacks, const BayDelta &delta,
+                vector<vector<int> > &newStacks, vector<int> &newLabel,
+                string &error) {
+    int n = 0;
+    for (auto &stack: stacks) {
+        n += stack.size();
+    }
+    // retrieval position of every item after the swaps
+    vector<int> position(n + 1);
+    for (int i=1; i <= n; i++) {
+        position[i] = i;
+    }
+    for (auto swap: delta.swaps) {
+        if ( swap.first < 1 || swap.first > n || swap.second < 1 ||
+             swap.second > n ) {
+            error = "swapped items must be 1.." + to_string(n);
+            return false;
+        }
+        std::swap(position[swap.first], position[swap.second]);
+    }
+    vector<bool> removed(n + 1, false);
+    for (auto item: delta.removals) {
+        if ( item < 1 || item > n || removed[item] ) {
+            error = "removed items must be 1.." + to_string(n) + ", each once";
+            return false;
+        }
+        removed[item] = true;
+    }
+    int newN = n - delta.removals.size() + delta.insertions.size();
+    vector<bool> taken(newN + 1, false);
+    for (auto insertion: delta.insertions) {
+        if ( insertion.first < 0 || insertion.first >= stacks.size() ) {
+            error = "insertions must be on stacks 0.." +
+                to_string(stacks.size() - 1);
+            return false;
+        }
+        if ( insertion.second < 1 || insertion.second > newN ||
+             taken[insertion.second] ) {
+            error = "inserted items must be 1.." + to_string(newN) +
+                ", each once";
+            return false;
+        }
+        taken[insertion.second] = true;
+    }
+    // the items left keep their order and take the free labels
+    vector<pair<int, int> > byPosition;
+    for (int i=1; i <= n; i++) {
+        if ( ! removed[i] ) {
+            byPosition.push_back(make_pair(position[i], i));
+        }
+    }
+    sort(byPosition.begin(), byPosition.end());
+    newLabel.assign(n + 1, 0);
+    int label = 1;
+    for (auto p: byPosition) {
+        while ( taken[label] ) {
+            label += 1;
+        }
+        newLabel[p.second] = label++;
+    }
+    newStacks.assign(stacks.size(), vector<int>());
+    for (int s=0; s < stacks.size(); s++) {
+        for (auto item: stacks[s]) {
+            if ( newLabel[item] != 0 ) {
+                newStacks[s].push_back(newLabel[item]);
+            }
+        }
+    }
+    for (auto insertion: delta.insertions) {
+        newStacks[insertion.first].push_back(insertion.second);
+    }
+    return true;
+}
+
+RepairedPlan repairPlan(const BRPState &oldBay,
+                        const vector<pair<int, int> > &plan,
+                        const BRPState &newBay,
+                        const vector<int> &newLabel,
+                        const BRPPolicy &repair,
+                        const Deadline &deadline) {
+    BRPState old(oldBay);
+    BRPState state(newBay);
+    while ( state.retrieveNext() );
+    RepairedPlan result;
+    result.kept = 0;
+    for (auto op: plan) {
+        int from = op.first;
+        int to = op.second;
+        if ( from < 0 || from >= old.W() || to < 0 || to >= old.W() ||
+             old.height(from) == 0 ) {
+            break;
+        }
+        // retrievals follow from the relocations in the changed bay
+        if ( from == to ) {
+            if ( ! old.retrieveNext() ) {
+                break;
+            }
+            continue;
+        }
+        if ( old.height(to) >= old.H() ) {
+            break;
+        }
+        int item = newLabel[old.top(from)];
+        old.relocate(from, to);
+        if ( item == 0 || state.height(from) == 0 ||
+             state.top(from) != item || state.height(to) >= state.H() ) {
+            break;
+        }
+        state.relocate(from, to);
+        result.kept += 1;
+        while ( state.retrieveNext() );
+    }
+    if ( state.empty() ) {
+        result.solution = make_shared<BRPState>(state);
+    } else {
+        result.solution = repair.solve(state, deadline);
+    }
+    return result;
+}
@@ -0,0 +1,56 @@
+#ifndef REPLAN_H
+#define REPLAN_H
+
+// re-planning after small changes to a bay
+// the plan made for the bay is replayed on the changed bay as long as its
+// relocations still move the same items, completed by a heuristic from
+// there, and can then be improved by a search method starting from it
+// (BRPPolicy::improve()) instead of solving the changed bay from scratch
+
+#include <vector>
+#include <string>
+#include <memory>
+
+#include "brpstate.h"
+#include "brppolicy.h"
+
+using namespace std;
+
+// changes to a bay; labels in swaps and removals are those of the bay
+// before the changes
+struct BayDelta {
+    // items exchanging their retrieval positions
+    vector<pair<int, int> > swaps;
+    // items that left the bay
+    vector<int> removals;
+    // new items as (stack, label) pairs, label being the retrieval position
+    // in the changed bay; they are put on top of their stack in this order
+    vector<pair<int, int> > insertions;
+};
+
+// stacks of the bay after delta; newLabel[i] is the label of item i in the
+// changed bay, 0 if it was removed
+// returns false and sets error if delta does not apply to stacks
+bool applyDelta(const vector<vector<int> > &stacks, const BayDelta &delta,
+                vector<vector<int> > &newStacks, vector<int> &newLabel,
+                string &error);
+
+struct RepairedPlan {
+    // relocations of the old plan kept
+    int kept;
+    // solution of the changed bay
+    shared_ptr<BRPState> solution;
+};
+
+// replay the operations of a plan for oldBay on newBay, the bay after a
+// delta whose labels are given by newLabel, up to the first relocation
+// that no longer moves the same item or no longer fits; the rest is solved
+// by repair
+RepairedPlan repairPlan(const BRPState &oldBay,
+                        const vector<pair<int, int> > &plan,
+                        const BRPState &newBay,
+                        const vector<int> &newLabel,
+                        const BRPPolicy &repair,
+                        const Deadline &deadline = Deadline());
+
+#endif
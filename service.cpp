@@ -0,0 +1,556 @@
+#include <sstream>
+#include <map>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <cstring>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "service.h"
+#include "batch.h"
+#include "genpolicy.h"
+#include "replan.h"
+#include "counters.h"
+
+// just enough json for the requests
+struct JSONValue {
+    enum Type { null, boolean, number, text, array, object };
+    Type type = null;
+    double value = 0;
+    string str;
+    vector<JSONValue> items;
+    map<string, JSONValue> fields;
+    // as it appears in the request, to echo ids
+    string raw;
+};
+
+class JSONParser {
+public:
+    JSONParser(const string &text) : text_(text), pos_(0), ok_(true) { }
+
+    // false if text is not a single json value
+    bool parse(JSONValue &result) {
+        result = parseValue();
+        skipSpaces();
+        return ok_ && pos_ == text_.size();
+    }
+
+protected:
+    const string &text_;
+    size_t pos_;
+    bool ok_;
+
+    void skipSpaces() {
+        while ( pos_ < text_.size() && isspace(text_[pos_]) ) {
+            pos_++;
+        }
+    }
+
+    bool accept(char c) {
+        skipSpaces();
+        if ( pos_ < text_.size() && text_[pos_] == c ) {
+            pos_++;
+            return true;
+        }
+        return false;
+    }
+
+    void expect(char c) {
+        if ( ! accept(c) ) {
+            ok_ = false;
+        }
+    }
+
+    string parseString() {
+        string result;
+        expect('"');
+        while ( ok_ && pos_ < text_.size() && text_[pos_] != '"' ) {
+            if ( text_[pos_] == '\\' ) {
+                pos_++;
+            }
+            if ( pos_ < text_.size() ) {
+                result += text_[pos_++];
+            }
+        }
+        expect('"');
+        return result;
+    }
+
+    JSONValue parseValue() {
+        JSONValue result;
+        skipSpaces();
+        size_t start = pos_;
+        if ( ! ok_ || pos_ >= text_.size() ) {
+            ok_ = false;
+        } else if ( text_[pos_] == '{' ) {
+            result.type = JSONValue::object;
+            pos_++;
+            if ( ! accept('}') ) {
+                do {
+                    skipSpaces();
+                    string key = parseString();
+                    expect(':');
+                    result.fields[key] = parseValue();
+                } while ( ok_ && accept(',') );
+                expect('}');
+            }
+        } else if ( text_[pos_] == '[' ) {
+            result.type = JSONValue::array;
+            pos_++;
+            if ( ! accept(']') ) {
+                do {
+                    result.items.push_back(parseValue());
+                } while ( ok_ && accept(',') );
+                expect(']');
+            }
+        } else if ( text_[pos_] == '"' ) {
+            result.type = JSONValue::text;
+            result.str = parseString();
+        } else if ( text_.compare(pos_, 4, "true") == 0 ||
+                    text_.compare(pos_, 5, "false") == 0 ) {
+            result.type = JSONValue::boolean;
+            result.value = text_[pos_] == 't';
+            pos_ += text_[pos_] == 't' ? 4 : 5;
+        } else if ( text_.compare(pos_, 4, "null") == 0 ) {
+            pos_ += 4;
+        } else {
+            result.type = JSONValue::number;
+            const char *begin = text_.c_str() + pos_;
+            char *end;
+            result.value = strtod(begin, &end);
+            if ( end == begin ) {
+                ok_ = false;
+            }
+            pos_ += end - begin;
+        }
+        result.raw = text_.substr(start, pos_ - start);
+        return result;
+    }
+};
+
+// stacks of a request, or false and an error message
+static bool readStacks(const JSONValue &value, vector<vector<int> > &stacks,
+                       string &error) {
+    if ( value.type != JSONValue::array || value.items.empty() ) {
+        error = "stacks must be a non-empty array of arrays";
+        return false;
+    }
+    unsigned int n = 0;
+    for (auto &stack: value.items) {
+        if ( stack.type != JSONValue::array ) {
+            error = "stacks must be a non-empty array of arrays";
+            return false;
+        }
+        n += stack.items.size();
+    }
+    vector<bool> seen(n + 1, false);
+    for (auto &stack: value.items) {
+        stacks.push_back(vector<int>());
+        for (auto &item: stack.items) {
+            if ( item.type != JSONValue::number || item.value < 1 ||
+                 item.value > n || item.value != (int) item.value ||
+                 seen[item.value] ) {
+                error = "items must be 1.." + to_string(n) + ", each once";
+                return false;
+            }
+            seen[item.value] = true;
+            stacks.back().push_back(item.value);
+        }
+    }
+    return true;
+}
+
+// array of integer pairs, or false
+static bool readPairs(const JSONValue &value, vector<pair<int, int> > &pairs) {
+    if ( value.type != JSONValue::array ) {
+        return false;
+    }
+    for (auto &p: value.items) {
+        if ( p.type != JSONValue::array || p.items.size() != 2 ||
+             p.items[0].type != JSONValue::number ||
+             p.items[1].type != JSONValue::number ) {
+            return false;
+        }
+        pairs.push_back(make_pair(p.items[0].value, p.items[1].value));
+    }
+    return true;
+}
+
+// "delta": {"swap": [[a, b], ...], "remove": [a, ...],
+//           "insert": [[stack, label], ...]}, every field being optional
+static bool readDelta(const JSONValue &value, BayDelta &delta,
+                      string &error) {
+    error = "delta must be an object with swap, remove and insert arrays";
+    if ( value.type != JSONValue::object ) {
+        return false;
+    }
+    auto field = [&](string name) {
+        auto it = value.fields.find(name);
+        return it == value.fields.end() ? JSONValue() : it->second;
+    };
+    JSONValue swaps = field("swap");
+    JSONValue removals = field("remove");
+    JSONValue insertions = field("insert");
+    if ( ( swaps.type != JSONValue::null &&
+           ! readPairs(swaps, delta.swaps) ) ||
+         ( insertions.type != JSONValue::null &&
+           ! readPairs(insertions, delta.insertions) ) ||
+         ( removals.type != JSONValue::null &&
+           removals.type != JSONValue::array ) ) {
+        return false;
+    }
+    for (auto &item: removals.items) {
+        if ( item.type != JSONValue::number ) {
+            return false;
+        }
+        delta.removals.push_back(item.value);
+    }
+    return true;
+}
+
+static string escape(string s) {
+    string result;
+    for (auto c: s) {
+        if ( c == '"' || c == '\\' ) {
+            result += '\\';
+        }
+        result += c;
+    }
+    return result;
+}
+
+// policy objects of one worker, kept between requests
+typedef map<string, unique_ptr<BRPPolicy> > PolicyCache;
+
+static string answerRequest(const string &line, PolicyCache &policies,
+                            const ServiceSettings &settings) {
+    JSONValue request;
+    JSONParser parser(line);
+    if ( ! parser.parse(request) || request.type != JSONValue::object ) {
+        return "{\"error\": \"request is not a json object\"}";
+    }
+    string id = request.fields.count("id") ? request.fields["id"].raw
+        : "null";
+    string reply = "{\"id\": " + id + ", ";
+    vector<vector<int> > stacks;
+    string error;
+    if ( ! readStacks(request.fields["stacks"], stacks, error) ) {
+        return reply + "\"error\": \"" + escape(error) + "\"}";
+    }
+    string method = settings.method;
+    if ( request.fields["method"].type == JSONValue::text ) {
+        method = request.fields["method"].str;
+    }
+    double timeLimit = settings.timeLimit;
+    if ( request.fields["tl"].type == JSONValue::number ) {
+        timeLimit = request.fields["tl"].value;
+    }
+    string maxHeightType = settings.maxHeightType;
+    if ( request.fields["maxHeight"].type == JSONValue::text ) {
+        maxHeightType = request.fields["maxHeight"].str;
+    }
+    if ( maxHeightType != "H+2" && maxHeightType != "2H-1" &&
+         maxHeightType != "unlimited" ) {
+        return reply + "\"error\": \"invalid maxHeight: " +
+            escape(maxHeightType) + "\"}";
+    }
+    if ( ! validPolicyName(method) ) {
+        return reply + "\"error\": \"invalid method: " + escape(method)
+            + "\"}";
+    }
+    BRPState s(stacks, maxHeightType);
+    s.setLBVersion(settings.lbVersion);
+    if ( ! s.canRelocate() ) {
+        return reply + "\"error\": \"no stack has room for a relocation\"}";
+    }
+    auto &policy = policies[method];
+    if ( policy == NULL ) {
+        policy = genPolicy(method, settings.context, 0, settings.bbStrategy,
+                           false);
+    }
+    // re-planning: stacks and plan are those of the bay before delta
+    vector<pair<int, int> > plan;
+    BayDelta delta;
+    bool replan = request.fields["plan"].type != JSONValue::null;
+    if ( replan && ! readPairs(request.fields["plan"], plan) ) {
+        return reply + "\"error\": \"plan must be an array of pairs\"}";
+    }
+    if ( request.fields["delta"].type != JSONValue::null &&
+         ( ! replan || ! readDelta(request.fields["delta"], delta, error) ) ) {
+        if ( ! replan ) {
+            error = "delta needs a plan";
+        }
+        return reply + "\"error\": \"" + escape(error) + "\"}";
+    }
+    auto before = chrono::steady_clock::now();
+    shared_ptr<BRPState> result;
+    int kept = 0;
+    if ( replan ) {
+        vector<vector<int> > newStacks;
+        vector<int> newLabel;
+        if ( ! applyDelta(stacks, delta, newStacks, newLabel, error) ) {
+            return reply + "\"error\": \"" + escape(error) + "\"}";
+        }
+        BRPState newBay(newStacks, maxHeightType);
+        newBay.setLBVersion(settings.lbVersion);
+        if ( ! newBay.canRelocate() ) {
+            return reply + "\"error\": \"no stack of the changed bay has "
+                "room for a relocation\"}";
+        }
+        Deadline deadline(timeLimit);
+        if ( newBay.empty() ) {
+            // nothing to plan, the policies expect items
+            result = make_shared<BRPState>(newBay);
+        } else {
+            RepairedPlan repaired = repairPlan(s, plan, newBay, newLabel,
+                                               *settings.context->ubSolver,
+                                               deadline);
+            kept = repaired.kept;
+            result = policy->improve(newBay, repaired.solution, deadline);
+        }
+        stacks = newStacks;
+    } else if ( s.empty() ) {
+        result = make_shared<BRPState>(s);
+    } else {
+        result = policy->solve(s, Deadline(timeLimit));
+    }
+    double time = chrono::duration<double>(chrono::steady_clock::now() -
+                                           before).count();
+    stringstream ss;
+    ss << reply << "\"method\": \"" << escape(method) << "\", "
+       << "\"relocations\": " << result->nRelocations() << ", "
+       << "\"time\": " << time << ", ";
+    if ( replan ) {
+        ss << "\"kept\": " << kept << ", \"stacks\": [";
+        for (int i=0; i < stacks.size(); i++) {
+            ss << (i > 0 ? ", " : "") << "[";
+            for (int j=0; j < stacks[i].size(); j++) {
+                ss << (j > 0 ? ", " : "") << stacks[i][j];
+            }
+            ss << "]";
+        }
+        ss << "], ";
+    }
+    ss << "\"moves\": [";
+    bool first = true;
+    for (auto op: result->operations()) {
+        ss << (first ? "" : ", ") << "[" << op.first << ", " << op.second
+           << "]";
+        first = false;
+    }
+    ss << "]}";
+    return ss.str();
+}
+
+// reply to one request; an exception thrown while answering it becomes an
+// error reply, so that one request cannot stop the service
+static string handleRequest(const string &line, PolicyCache &policies,
+                            const ServiceSettings &settings) {
+    try {
+        return answerRequest(line, policies, settings);
+    } catch (const exception &e) {
+        JSONValue request;
+        JSONParser parser(line);
+        string id = parser.parse(request) && request.fields.count("id") ?
+            request.fields["id"].raw : "null";
+        return "{\"id\": " + id + ", \"error\": \"" + escape(e.what()) +
+            "\"}";
+    }
+}
+
+// where the replies to a request go; shared by the requests of one client
+struct ReplyChannel {
+    mutex m;
+    function<void(const string &)> write;
+    // called once the last request of the client has been answered
+    function<void()> close;
+
+    ~ReplyChannel() {
+        if ( close ) {
+            close();
+        }
+    }
+};
+
+struct Job {
+    string line;
+    shared_ptr<ReplyChannel> channel;
+};
+
+// requests waiting for a worker
+class JobQueue {
+public:
+    void push(Job job) {
+        lock_guard<mutex> lock(m_);
+        jobs_.push_back(job);
+        available_.notify_one();
+    }
+
+    // no more jobs after this
+    void close() {
+        lock_guard<mutex> lock(m_);
+        closed_ = true;
+        available_.notify_all();
+    }
+
+    // false once the queue is closed and empty
+    bool pop(Job &job) {
+        unique_lock<mutex> lock(m_);
+        available_.wait(lock, [&]() { return closed_ || ! jobs_.empty(); });
+        if ( jobs_.empty() ) {
+            return false;
+        }
+        job = jobs_.front();
+        jobs_.pop_front();
+        return true;
+    }
+
+protected:
+    mutex m_;
+    condition_variable available_;
+    deque<Job> jobs_;
+    bool closed_ = false;
+};
+
+static vector<thread> startWorkers(JobQueue &queue,
+                                   const ServiceSettings &settings) {
+    vector<thread> workers;
+    for (unsigned int t=0; t < max(1u, settings.nThreads); t++) {
+        workers.push_back(thread([&]() {
+                    PolicyCache policies;
+                    Job job;
+                    while ( queue.pop(job) ) {
+                        string reply = handleRequest(job.line, policies,
+                                                     settings);
+                        lock_guard<mutex> lock(job.channel->m);
+                        job.channel->write(reply + "\n");
+                        // the channel may be closed as soon as we drop it
+                        job.channel.reset();
+                    }
+                    Counters::mergeThread();
+                }));
+    }
+    return workers;
+}
+
+void serveStream(istream &is, ostream &os, const ServiceSettings &settings) {
+    auto channel = make_shared<ReplyChannel>();
+    channel->write = [&](const string &reply) { os << reply << flush; };
+    JobQueue queue;
+    vector<thread> workers = startWorkers(queue, settings);
+    string line;
+    while ( getline(is, line) ) {
+        if ( ! line.empty() ) {
+            queue.push(Job{line, channel});
+        }
+    }
+    queue.close();
+    for (auto &t: workers) {
+        t.join();
+    }
+}
+
+// write everything, false if the other end is gone
+static bool writeAll(int fd, const string &data) {
+    size_t done = 0;
+    while ( done < data.size() ) {
+        ssize_t n = send(fd, data.c_str() + done, data.size() - done,
+                         MSG_NOSIGNAL);
+        if ( n <= 0 ) {
+            return false;
+        }
+        done += n;
+    }
+    return true;
+}
+
+// call f on every line read from fd until it is closed
+static void readLines(int fd, function<void(const string &)> f) {
+    string pending;
+    char buffer[4096];
+    ssize_t n;
+    while ( (n = read(fd, buffer, sizeof(buffer))) > 0 ) {
+        pending.append(buffer, n);
+        size_t end;
+        while ( (end = pending.find('\n')) != string::npos ) {
+            f(pending.substr(0, end));
+            pending.erase(0, end + 1);
+        }
+    }
+    if ( ! pending.empty() ) {
+        f(pending);
+    }
+}
+
+static sockaddr_un socketAddress(string path) {
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if ( path.size() >= sizeof(address.sun_path) ) {
+        cerr << "socket path too long: " << path << endl;
+        exit(8);
+    }
+    strcpy(address.sun_path, path.c_str());
+    return address;
+}
+
+void serveSocket(string path, const ServiceSettings &settings) {
+    sockaddr_un address = socketAddress(path);
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path.c_str());
+    if ( server < 0 ||
+         bind(server, (sockaddr *) &address, sizeof(address)) != 0 ||
+         listen(server, 64) != 0 ) {
+        cerr << "cannot listen on " << path << ": " << strerror(errno)
+             << endl;
+        exit(8);
+    }
+    JobQueue queue;
+    vector<thread> workers = startWorkers(queue, settings);
+    while ( true ) {
+        int client = accept(server, NULL, NULL);
+        if ( client < 0 ) {
+            continue;
+        }
+        // one reader per client; its socket is closed once the client has
+        // stopped sending and every request has been answered
+        thread([client, &queue]() {
+                auto channel = make_shared<ReplyChannel>();
+                channel->write = [client](const string &reply) {
+                    writeAll(client, reply);
+                };
+                channel->close = [client]() { ::close(client); };
+                readLines(client, [&](const string &line) {
+                        if ( ! line.empty() ) {
+                            queue.push(Job{line, channel});
+                        }
+                    });
+            }).detach();
+    }
+}
+
+void runClient(string path, istream &is, ostream &os) {
+    sockaddr_un address = socketAddress(path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if ( fd < 0 ||
+         connect(fd, (sockaddr *) &address, sizeof(address)) != 0 ) {
+        cerr << "cannot connect to " << path << ": " << strerror(errno)
+             << endl;
+        exit(8);
+    }
+    // send while replies come back, so that neither side blocks the other
+    thread sender([&]() {
+            string line;
+            while ( getline(is, line) && writeAll(fd, line + "\n") );
+            shutdown(fd, SHUT_WR);
+        });
+    readLines(fd, [&](const string &line) { os << line << endl; });
+    sender.join();
+    ::close(fd);
+}
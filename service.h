@@ -0,0 +1,46 @@
+#ifndef SERVICE_H
+#define SERVICE_H
+
+// long-lived solver service
+// requests are json lines such as
+//   {"id": 7, "method": "GLAH-2", "tl": 1, "stacks": [[3, 1], [2], [4]]}
+// where stacks go from bottom to top and items are labelled 1..n; only
+// "stacks" is required. Each request gets one json line in reply, with the
+// same id, the number of relocations, the time and the moves as (from, to)
+// pairs, (from, from) being a retrieval; or with an "error" field.
+// Replies come in the order in which requests are solved.
+// A request with a "plan" for its stacks and a "delta" is re-planned from
+// that plan, see replan.h.
+
+#include <string>
+#include <iostream>
+
+#include "solvercontext.h"
+
+using namespace std;
+
+struct ServiceSettings {
+    // UB procedures and settings; should be quiet, as progress reports of
+    // the solvers would be mixed up with the replies
+    shared_ptr<const SolverContext> context;
+    int lbVersion = 1;
+    // used when a request does not specify them
+    string method = "LA-1";
+    double timeLimit = 0;
+    string maxHeightType = "H+2";
+    string bbStrategy = "depth";
+    // worker threads, each one keeps its own policy objects
+    unsigned int nThreads = 1;
+};
+
+// serve the requests read from is until it ends, replies go to os
+void serveStream(istream &is, ostream &os, const ServiceSettings &settings);
+
+// serve the clients of a Unix socket created at path, forever
+void serveSocket(string path, const ServiceSettings &settings);
+
+// stand-in client: send the lines of is to the service listening on path,
+// and write its replies to os
+void runClient(string path, istream &is, ostream &os);
+
+#endif
@@ -0,0 +1,110 @@
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <cstdint>
+
+#include "solutionsink.h"
+
+SolutionSink::SolutionSink(string fName) : ofs_(fName, ofstream::binary) {
+    if ( ! ofs_ ) {
+        cerr << "cannot write solutions to " << fName << endl;
+        exit(11);
+    }
+}
+
+void SolutionSink::write(string name, const BRPState &initial,
+                         const BRPState &solution) {
+    string text = format(name, initial, solution);
+    lock_guard<mutex> lock(mutex_);
+    ofs_.write(text.data(), text.size());
+}
+
+void SolutionSink::flush() {
+    lock_guard<mutex> lock(mutex_);
+    ofs_.flush();
+}
+
+string TextSolutionSink::format(string name, const BRPState &initial,
+                                const BRPState &solution) const {
+    stringstream ss;
+    initial.writeInstance(ss);
+    solution.writeSolution(ss);
+    return ss.str();
+}
+
+static void append(string &buffer, const void *value, size_t size) {
+    buffer.append((const char *) value, size);
+}
+
+BinarySolutionSink::BinarySolutionSink(string fName) : SolutionSink(fName) {
+    const uint32_t version = 1;
+    ofs_.write("BRPS", 4);
+    ofs_.write((const char *) &version, sizeof(version));
+}
+
+string BinarySolutionSink::format(string name, const BRPState &initial,
+                                  const BRPState &solution) const {
+    static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+                  "binary solutions are written as little-endian data");
+    auto &operations = solution.operations();
+    string buffer;
+    uint16_t nameLength = min<size_t>(name.size(), UINT16_MAX);
+    uint32_t nRelocations = solution.nRelocations();
+    uint32_t nOperations = operations.size();
+    uint8_t indexBytes = initial.W() <= 256 ? 1 : 2;
+    buffer.reserve(11 + nameLength + 2 * indexBytes * nOperations);
+    append(buffer, &nameLength, sizeof(nameLength));
+    buffer.append(name, 0, nameLength);
+    append(buffer, &nRelocations, sizeof(nRelocations));
+    append(buffer, &nOperations, sizeof(nOperations));
+    append(buffer, &indexBytes, sizeof(indexBytes));
+    for (auto op: operations) {
+        if ( indexBytes == 1 ) {
+            uint8_t pair[2] = { (uint8_t) op.first, (uint8_t) op.second };
+            append(buffer, pair, sizeof(pair));
+        } else {
+            uint16_t pair[2] = { (uint16_t) op.first, (uint16_t) op.second };
+            append(buffer, pair, sizeof(pair));
+        }
+    }
+    return buffer;
+}
+
+string JSONSolutionSink::format(string name, const BRPState &initial,
+                                const BRPState &solution) const {
+    stringstream ss;
+    ss << "{\"instance\": \"";
+    for (auto c: name) {
+        if ( c == '"' || c == '\\' ) {
+            ss << '\\';
+        }
+        ss << c;
+    }
+    ss << "\", \"relocations\": " << solution.nRelocations()
+       << ", \"moves\": [";
+    bool first = true;
+    for (auto op: solution.operations()) {
+        ss << (first ? "" : ", ") << "[" << op.first << ", " << op.second
+           << "]";
+        first = false;
+    }
+    ss << "]}\n";
+    return ss.str();
+}
+
+bool validSolutionFormat(string format) {
+    return format == "text" || format == "binary" || format == "json";
+}
+
+unique_ptr<SolutionSink> makeSolutionSink(string format, string fName) {
+    if ( format == "text" ) {
+        return make_unique<TextSolutionSink>(fName);
+    } else if ( format == "binary" ) {
+        return make_unique<BinarySolutionSink>(fName);
+    } else if ( format == "json" ) {
+        return make_unique<JSONSolutionSink>(fName);
+    } else {
+        cerr << "unknown solution format: " << format << endl;
+        exit(6);
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef SOLUTIONSINK_H
+#define SOLUTIONSINK_H
+
+#include <string>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+#include "brpstate.h"
+
+using namespace std;
+
+// where the solutions of one or more instances are written
+// the file is opened once and written through its buffer; solutions are
+// formatted by the calling thread, so the workers of a batch can share a
+// sink. Everything is written when the sink is flushed or destroyed.
+class SolutionSink {
+public:
+    explicit SolutionSink(string fName);
+    virtual ~SolutionSink() { flush(); }
+
+    // name identifies the instance, initial is the instance and solution
+    // the state a policy returned for it
+    void write(string name, const BRPState &initial,
+               const BRPState &solution);
+
+    void flush();
+
+protected:
+    virtual string format(string name, const BRPState &initial,
+                          const BRPState &solution) const = 0;
+
+    mutex mutex_;
+    ofstream ofs_;
+};
+
+// script format of BRPState::writeInstance() and writeSolution()
+class TextSolutionSink: public SolutionSink {
+public:
+    explicit TextSolutionSink(string fName) : SolutionSink(fName) { }
+
+protected:
+    virtual string format(string name, const BRPState &initial,
+                          const BRPState &solution) const;
+};
+
+// "BRPS", uint32 version, then per solution, little-endian:
+//   uint16 name length, the name, uint32 relocations, uint32 operations,
+//   uint8 bytes per stack index (1 if W <= 256, 2 otherwise), then the
+//   operations as (from, to) pairs of stack indices, (from, from) being a
+//   retrieval
+class BinarySolutionSink: public SolutionSink {
+public:
+    explicit BinarySolutionSink(string fName);
+
+protected:
+    virtual string format(string name, const BRPState &initial,
+                          const BRPState &solution) const;
+};
+
+// one json line per solution: instance name, relocations and moves as
+// (from, to) pairs
+class JSONSolutionSink: public SolutionSink {
+public:
+    explicit JSONSolutionSink(string fName) : SolutionSink(fName) { }
+
+protected:
+    virtual string format(string name, const BRPState &initial,
+                          const BRPState &solution) const;
+};
+
+// format is text, binary or json
+unique_ptr<SolutionSink> makeSolutionSink(string format, string fName);
+
+// true if makeSolutionSink() accepts format
+bool validSolutionFormat(string format);
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef SOLVERCONTEXT_H
+#define SOLVERCONTEXT_H
+
+#include <string>
+#include <memory>
+#include <iostream>
+
+using namespace std;
+
+class BRPPolicy;
+
+// dominance rules of the exact methods, see dominance.h
+enum DominanceRule {
+    orderRule = 1,
+    transitiveRule = 2,
+    returnRule = 4,
+    allDominanceRules = 7
+};
+
+// nodes of DFBB where its dive heuristic runs, see dfbb.h
+enum DiveSchedule {
+    diveByDepth,
+    diveByGap,
+    diveAdaptive
+};
+
+// settings shared by the policies taking part in a solve
+// a context is not modified once built, so it can be shared between
+// threads; solves with different settings use different contexts
+struct SolverContext {
+    // UB procedure for exact methods
+    shared_ptr<BRPPolicy> ubSolver;
+    // UB procedure for heuristic methods
+    shared_ptr<BRPPolicy> hubSolver;
+    bool verbose = false;
+    // for SmSEQC-X procedures
+    string condensationProcedure = "tricoire";
+    // dominance rules used by the exact methods
+    unsigned int dominanceRules = allDominanceRules;
+    // exact methods solve the restricted BRP, where only the items above
+    // the next one are relocated
+    bool restricted = false;
+    // heuristic DFBB dives from some of its nodes, none if null; which
+    // nodes depends on the schedule and its parameter
+    shared_ptr<BRPPolicy> diveSolver;
+    DiveSchedule diveSchedule = diveAdaptive;
+    int diveParam = 100;
+    // where search methods report their progress
+    ostream *log = &cout;
+};
+
+// discards everything, for contexts that should not report anything
+class NullBuffer: public streambuf {
+protected:
+    virtual int overflow(int c) { return c; }
+};
+
+#endif
@@ -2,7 +2,6 @@
 
 #include "subsequence.h"
 
-extern string condensationProcedure;
 
 ostream& operator<<(ostream &os, const Sequence& s) {
     auto it = s.top();
@@ -23,13 +22,10 @@ bool SubsequencePolicy::voluntaryMoves(BRPState &state) const {
 // sequence is from top to bottom so we return reverse iterators
 const Sequence SubsequencePolicy::nextDecreasingSequence(BRPState &state,
                                                          unsigned int s) const {
+    // the sequence stops above the next item
+    int length = min(state.topRun(s), state.depth(state.next()));
     vector<int>::reverse_iterator seqTop = state.topIt(s);
-    vector<int>::reverse_iterator seqBottom = seqTop;
-    while ( *(seqBottom + 1) != state.next() &&
-            *(seqBottom + 1) <= *seqBottom ) {
-        seqBottom++;
-    }
-    return Sequence(seqTop, seqBottom);
+    return Sequence(seqTop, seqTop + length - 1);
 }
 
 // try to relocate the decreasing subsequence blocking state.next()
@@ -87,10 +83,7 @@ pair<int, int> SubsequencePolicy::bestSubsequenceFit(BRPState &state,
     // cout << "\tinitial position: " << position << endl;
     while ( position + seq.size() > state.H() ||
             ( position > 0 &&
-              *(seq.bottom()) > *(min_element(state.stacks()[s].begin(),
-              // *(seq.top()) > *(min_element(state.stacks()[s].begin(),
-                                           state.stacks()[s].begin()
-                                           + position) ) &&
+              *(seq.bottom()) > state.lowestUpTo(s, position - 1) &&
               state.height(s) - position < nFreeSlots ) ) {
         position -= 1;
     }
@@ -123,9 +116,8 @@ pair<int, int> SubsequencePolicy::bestSubsequenceFit(BRPState &state,
     if (position == 0) {
         localMin = state.n() + 1;
     } else {
-        localMin = *(min_element(state.stacks()[s].begin(),
-                                 state.stacks()[s].begin()
-                                 + position - 1));
+        // the item at position - 1 is not included, except at the bottom
+        localMin = state.lowestUpTo(s, position > 1 ? position - 2 : 0);
     }
     auto it = seq.top();
     while (it != seq.bottom()) {
@@ -162,12 +154,12 @@ bool SmartSubsequencePolicy::voluntaryMoves(BRPState &state) const {
 }
 
 shared_ptr<BRPState> SmartSubsequencePolicy::
-solve(const BRPState &state) const {
-    shared_ptr<BRPState> tmp = SafeMovesPolicy::solve(state);
-    if ( condensationProcedure == "tricoire" ) {
-        tmp->condenseTricoire();
-    } else if ( condensationProcedure == "jin" ) {
-        tmp->condenseJin();
+solve(const BRPState &state, const Deadline &deadline) const {
+    shared_ptr<BRPState> tmp = SafeMovesPolicy::solve(state, deadline);
+    if ( context().condensationProcedure == "tricoire" ) {
+        tmp->condenseTricoire(deadline);
+    } else if ( context().condensationProcedure == "jin" ) {
+        tmp->condenseJin(deadline);
     }
     return tmp;
 }
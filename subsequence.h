@@ -58,7 +58,9 @@ public:
     SmartSubsequencePolicy( unsigned int level=1 ) : level_(level) {}
     virtual string name() const { return "SmartSubsequencePolicy(" +
             to_string(level_) + ")"; }
-    shared_ptr<BRPState> solve(const BRPState &state) const;
+    shared_ptr<BRPState>
+    solve(const BRPState &state,
+          const Deadline &deadline = Deadline()) const;
 protected:
     unsigned int level_;
     virtual bool voluntaryMoves(BRPState &state) const;
@@ -0,0 +1,30 @@
+#!/bin/sh
+# the dominance rules only skip nodes that cannot lead to a better
+# solution: the exact methods must find the same number of relocations
+# with -dominance none and all, on small generated bays
+# usage: tests/dominance.sh <brp executable>
+
+BRP=${1:-./brp}
+status=0
+count=0
+for shape in "4 4" "5 4" "6 3" "3 5"; do
+    set -- $shape
+    for seed in 1 2 3 4 5 6 7 8 9 10; do
+        for method in DFBB BB DFBB-L; do
+            for maxHeight in H+2 unlimited; do
+                options="-gen uniform -W $1 -H $2 -seed $seed -m $method"
+                options="$options -maxHeight $maxHeight"
+                none=$($BRP $options -dominance none | awk '/ used / {print $3}')
+                all=$($BRP $options -dominance all | awk '/ used / {print $3}')
+                count=$((count + 1))
+                if [ -z "$none" ] || [ "$none" != "$all" ]; then
+                    echo "FAIL $options: $none relocations without" \
+                         "dominance, $all with"
+                    status=1
+                fi
+            done
+        done
+    done
+done
+echo "dominance: $count bays compared"
+exit $status
@@ -0,0 +1,37 @@
+#!/bin/sh
+# the exact methods must find the restricted optima of tests/restricted.txt
+# with -variant restricted, and only relocate items above the next one
+# usage: tests/restricted.sh <brp executable>
+
+BRP=${1:-./brp}
+DIR=$(dirname "$0")
+SOLUTION=$(mktemp)
+status=0
+count=0
+while read W H seed maxHeight expected; do
+    case "$W" in
+        ''|'#'*) continue ;;
+    esac
+    for method in DFBB BB DFBB-L; do
+        options="-gen uniform -W $W -H $H -seed $seed -m $method"
+        options="$options -maxHeight $maxHeight -variant restricted"
+        found=$($BRP $options -sf "$SOLUTION" < /dev/null |
+                    awk '/ used / {print $3}')
+        # every relocation between two retrievals is from the stack of
+        # the second one
+        restricted=$(awk '/relocating/ { from[++k] = $4 }
+                          /retrieving/ { for (j=1; j <= k; j++)
+                                             if (from[j] != $4) bad = 1;
+                                         k = 0 }
+                          END { print bad ? "no" : "yes" }' "$SOLUTION")
+        count=$((count + 1))
+        if [ "$found" != "$expected" ] || [ "$restricted" != yes ]; then
+            echo "FAIL $options: $found relocations instead of" \
+                 "$expected, restricted moves: $restricted"
+            status=1
+        fi
+    done
+done < "$DIR/restricted.txt"
+rm -f "$SOLUTION"
+echo "restricted: $count bays compared"
+exit $status
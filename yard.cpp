@@ -0,0 +1,181 @@
+#include <fstream>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+#include "yard.h"
+#include "genpolicy.h"
+#include "counters.h"
+
+Yard readYard(string fName) {
+    ifstream ifs(fName);
+    if ( ! ifs ) {
+        cerr << "cannot read yard: " << fName << endl;
+        exit(10);
+    }
+    auto invalid = [&](string reason) {
+        cerr << "invalid yard " << fName << ": " << reason << endl;
+        exit(10);
+    };
+    Yard yard;
+    int nBays;
+    if ( ! (ifs >> nBays >> yard.n) || nBays < 1 || yard.n < 0 ) {
+        invalid("expected the number of bays and of items");
+    }
+    vector<bool> seen(yard.n + 1, false);
+    int nRead = 0;
+    yard.bays.resize(nBays);
+    for (int b=0; b < nBays; b++) {
+        int W, n;
+        if ( ! (ifs >> W >> n) || W < 1 || n < 0 ) {
+            invalid("expected the number of stacks and of items of bay " +
+                    to_string(b));
+        }
+        yard.bays[b].resize(W);
+        int nBay = 0;
+        for (int s=0; s < W; s++) {
+            int h, item;
+            if ( ! (ifs >> h) || h < 0 || nBay + h > n ) {
+                invalid("bad height for stack " + to_string(s) + " of bay " +
+                        to_string(b));
+            }
+            for (int j=0; j < h; j++) {
+                if ( ! (ifs >> item) || item < 1 || item > yard.n ||
+                     seen[item] ) {
+                    invalid("items must be 1.." + to_string(yard.n) +
+                            ", each once");
+                }
+                seen[item] = true;
+                yard.bays[b][s].push_back(item);
+            }
+            nBay += h;
+        }
+        if ( nBay != n ) {
+            invalid(to_string(nBay) + " items instead of " + to_string(n) +
+                    " in bay " + to_string(b));
+        }
+        // with two stacks or more, every max. height leaves room for the
+        // first relocation; a single stack has none for its blockers
+        const vector<int> &stack = yard.bays[b][0];
+        if ( W == 1 && ! is_sorted(stack.rbegin(), stack.rend()) ) {
+            invalid("bay " + to_string(b) + " has a single stack, whose "
+                    "items cannot be relocated");
+        }
+        nRead += n;
+    }
+    if ( nRead != yard.n ) {
+        invalid(to_string(nRead) + " items instead of " + to_string(yard.n));
+    }
+    return yard;
+}
+
+vector<vector<int> > bayStacks(const Yard &yard, int b, vector<int> &label) {
+    const vector<vector<int> > &bay = yard.bays[b];
+    label.assign(1, 0);
+    for (auto &stack: bay) {
+        label.insert(label.end(), stack.begin(), stack.end());
+    }
+    sort(label.begin() + 1, label.end());
+    vector<vector<int> > result(bay.size());
+    for (int s=0; s < bay.size(); s++) {
+        for (auto item: bay[s]) {
+            result[s].push_back(lower_bound(label.begin() + 1, label.end(),
+                                            item) - label.begin());
+        }
+    }
+    return result;
+}
+
+YardPlan solveYard(const Yard &yard, const YardSettings &settings) {
+    size_t nBays = yard.bays.size();
+    // largest bays first
+    vector<pair<int, int> > order;
+    for (int b=0; b < nBays; b++) {
+        int n = 0;
+        for (auto &stack: yard.bays[b]) {
+            n += stack.size();
+        }
+        order.push_back(make_pair(-n, b));
+    }
+    sort(order.begin(), order.end());
+    YardPlan plan;
+    plan.bays.resize(nBays);
+    Deadline deadline(settings.timeLimit);
+    atomic<unsigned int> nextBay(0);
+    auto worker = [&]() {
+        // the solver is kept from one bay to the next
+        auto solver = genPolicy(settings.method, settings.context,
+                                settings.timeLimit, settings.bbStrategy,
+                                false);
+        unsigned int i;
+        while ( (i = nextBay++) < nBays ) {
+            int b = order[i].second;
+            vector<int> label;
+            BRPState s(bayStacks(yard, b, label), settings.maxHeightType);
+            s.setLBVersion(settings.lbVersion);
+            auto before = chrono::steady_clock::now();
+            BaySolution &bay = plan.bays[b];
+            bay.solution = s.empty() ? make_shared<BRPState>(s) :
+                solver->solve(s, deadline);
+            bay.time = chrono::duration<double>(
+                chrono::steady_clock::now() - before).count();
+            bay.status = "feasible";
+            if ( bay.solution->nRelocations() == s.LB3() ||
+                 ( solver->exact() && ! deadline.reached() ) ) {
+                bay.status = "optimal";
+            } else if ( deadline.reached() ) {
+                bay.status = "timeout";
+            }
+        }
+        Counters::mergeThread();
+    };
+    vector<thread> threads;
+    unsigned int nThreads = min<size_t>(max(1u, settings.nThreads), nBays);
+    for (unsigned int t=0; t < nThreads; t++) {
+        threads.push_back(thread(worker));
+    }
+    for (auto &t: threads) {
+        t.join();
+    }
+    plan.moves = mergeBayPlans(yard, plan.bays);
+    plan.nRelocations = 0;
+    for (auto &bay: plan.bays) {
+        plan.nRelocations += bay.solution->nRelocations();
+    }
+    return plan;
+}
+
+vector<YardMove> mergeBayPlans(const Yard &yard,
+                               const vector<BaySolution> &bays) {
+    vector<int> bayOf(yard.n + 1);
+    for (int b=0; b < yard.bays.size(); b++) {
+        for (auto &stack: yard.bays[b]) {
+            for (auto item: stack) {
+                bayOf[item] = b;
+            }
+        }
+    }
+    // the bays retrieve their items in the order of the yard sequence, so
+    // the k-th retrieval of a bay is that of its k-th item in the sequence
+    vector<size_t> nextOp(bays.size(), 0);
+    vector<YardMove> result;
+    for (int item=1; item <= yard.n; item++) {
+        int b = bayOf[item];
+        auto &ops = bays[b].solution->operations();
+        while ( nextOp[b] < ops.size() ) {
+            auto op = ops[nextOp[b]++];
+            result.push_back(YardMove{b, op.first, op.second});
+            if ( op.first == op.second ) {
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+void writeYardPlan(ostream &os, const YardPlan &plan) {
+    for (auto &move: plan.moves) {
+        os << move.bay << " " << move.from << " " << move.to << "\n";
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef YARD_H
+#define YARD_H
+
+// yard blocks: several bays sharing one retrieval sequence
+// items are only relocated within their bay, so every bay is solved on its
+// own, with its items relabelled in the order of the yard sequence, and the
+// moves of the bays are merged back in that order
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <iostream>
+
+#include "brpstate.h"
+#include "solvercontext.h"
+
+using namespace std;
+
+struct Yard {
+    // bays[b][s] is stack s of bay b, from bottom to top; items are labelled
+    // 1..n in the order they leave the yard
+    vector<vector<vector<int> > > bays;
+    int n = 0;
+};
+
+// read a yard: the number of bays and of items, then every bay in the
+// format of Caserta et al. (stacks, items, then the stacks), with the labels
+// of the yard; exits if the file cannot be read or is not a valid yard
+Yard readYard(string fName);
+
+// stacks of bay b with its items relabelled 1..n_b in retrieval order;
+// label[i] is the yard label of item i of the bay
+vector<vector<int> > bayStacks(const Yard &yard, int b, vector<int> &label);
+
+// operation of a yard plan; a retrieval if from == to
+struct YardMove {
+    int bay;
+    int from;
+    int to;
+};
+
+struct YardSettings {
+    // UB procedures and settings; should be quiet, as the bays are solved
+    // at the same time
+    shared_ptr<const SolverContext> context;
+    int lbVersion = 1;
+    string method = "LA-1";
+    string maxHeightType = "unlimited";
+    string bbStrategy = "depth";
+    // for the whole yard, 0 means no limit
+    int timeLimit = 0;
+    // number of workers, each one solves one bay at a time
+    unsigned int nThreads = 1;
+};
+
+struct BaySolution {
+    // in the labels of the bay
+    shared_ptr<BRPState> solution;
+    double time;
+    // optimal, timeout or feasible
+    string status;
+};
+
+struct YardPlan {
+    vector<BaySolution> bays;
+    // the operations of all bays, in the order of the yard sequence
+    vector<YardMove> moves;
+    int nRelocations;
+};
+
+// solve every bay with settings.method, the largest bays first so that the
+// workers finish together, and merge their solutions
+YardPlan solveYard(const Yard &yard, const YardSettings &settings);
+
+// the operations of the bay solutions in the order of the yard sequence:
+// the retrieval of each item, preceded by the relocations its bay makes
+// before it
+vector<YardMove> mergeBayPlans(const Yard &yard,
+                               const vector<BaySolution> &bays);
+
+// one "bay from to" line per move
+void writeYardPlan(ostream &os, const YardPlan &plan);
+
+#endif